@@ -0,0 +1,262 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "./src/lib_supp.h"
+#include "./src/lib_graph.h"
+#include "./src/lib_pagerank.h"
+#include "./src/lib_threads.h"
+#include "./src/lib_gen.h"
+
+/**
+ * Benchmark driver: synthetic graphs of every model and
+ * size, written in memory (memfd) or on disk, then parsed
+ * and ranked for every thread count. Each measure is taken
+ * after the warm-up runs over the timed trials, one line
+ * per (model, size, threads, phase) on stdout:
+ *
+ *      model nodes edges threads phase median_s p95_s median_eps p95_eps
+ *
+ * eps are edges per second at the median and at the 95th
+ * percentile time (the slow tail): input lines for parse,
+ * in-edges times iterations for pagerank (run with e = 0,
+ * so always m iterations)
+ */
+
+#define BENCH_LIST 16   //longest value list of an option
+
+/**
+ * global variables shared with signal handler
+ */
+double *X_previous;
+float  *Xf_previous;
+pthread_mutex_t signal_mux;
+
+static double bench_clock(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//comma separated positive integers, returns the count
+static int bench_list(const char *arg, int *values){
+    int count = 0;
+    char *copy = strdup(arg);
+    char *save = NULL;
+
+    for(char *tok = strtok_r(copy, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)){
+        if(count == BENCH_LIST || atoi(tok) < 1){
+            fprintf(stderr,"[bench] bad list: %s\n",arg);
+            exit(EXIT_FAILURE);
+        }
+        values[count++] = atoi(tok);
+    }
+
+    free(copy);
+    return count;
+}
+
+static int cmp_double(const void *a, const void *b){
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+//nearest rank percentile of the sorted times
+static double bench_percentile(const double *sorted, int n, double p){
+    int rank = (int)(p * n + 0.999999);
+    if(rank < 1)
+        rank = 1;
+    return sorted[rank - 1];
+}
+
+static void bench_print(const char *model, int nodes, long edges, int threads, const char *phase, double *times, int n, double work){
+    qsort(times, n, sizeof(double), cmp_double);
+    const double median = (n % 2 == 1) ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+    const double p95    = bench_percentile(times, n, 0.95);
+
+    printf("%s\t%d\t%ld\t%d\t%s\t%.6f\t%.6f\t%.0f\t%.0f\n",
+        model, nodes, edges, threads, phase, median, p95, work / median, work / p95);
+    fflush(stdout);
+}
+
+static void bench_help(const char *name){
+    printf("usage: %s [-g MODELS] [-n SIZES] [-t THREADS] [-D DEG] [-w W] [-r R] [-m M] [--dir D] [--seed S]\n",name);
+    puts("");
+    puts("-g MODELS\tcomma separated graph models: rmat, ba, er (default all)");
+    puts("-n SIZES\tcomma separated node counts (default 10000,100000)");
+    puts("-t THREADS\tcomma separated thread counts (default 1,2,4)");
+    puts("-D DEG\t\tedges per node (default 8)");
+    puts("-w W\t\twarm-up runs, not measured (default 1)");
+    puts("-r R\t\ttimed trials (default 5)");
+    puts("-m M\t\tpagerank iterations per trial (default 20)");
+    puts("--dir D\t\twrite the graphs as files in D instead of in memory");
+    puts("--seed S\tgenerator seed (default 1)");
+}
+
+int main(int argc, char *argv[])
+{
+    int models[BENCH_LIST]  = {GEN_RMAT, GEN_BA, GEN_ER};
+    int model_count         = 3;
+    int sizes[BENCH_LIST]   = {10000, 100000};
+    int size_count          = 2;
+    int threads[BENCH_LIST] = {1, 2, 4};
+    int thread_count        = 3;
+    int degree              = 8;
+    int warmup              = 1;
+    int trials              = 5;
+    int m                   = 20;
+    double d                = 0.9;
+    char *dir               = NULL;
+    uint64_t seed           = 1;
+
+    enum {OPT_DIR = 256, OPT_SEED};
+    static struct option long_opts[] = {
+        {"dir",     required_argument,  NULL,   OPT_DIR},
+        {"seed",    required_argument,  NULL,   OPT_SEED},
+        {NULL,      0,                  NULL,   0}
+    };
+
+    int opt;
+    while((opt = getopt_long(argc, argv, "hg:n:t:D:w:r:m:", long_opts, NULL)) != -1){
+        switch(opt){
+            case 'g':
+                model_count = 0;
+                for(char *tok = strtok(optarg, ","); tok != NULL; tok = strtok(NULL, ",")){
+                    if(model_count == BENCH_LIST){
+                        fprintf(stderr,"[bench] too many models\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    if(strcmp(tok,"rmat") == 0)
+                        models[model_count++] = GEN_RMAT;
+                    else if(strcmp(tok,"ba") == 0)
+                        models[model_count++] = GEN_BA;
+                    else if(strcmp(tok,"er") == 0)
+                        models[model_count++] = GEN_ER;
+                    else{
+                        fprintf(stderr,"[bench] unknown model: %s\n",tok);
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                break;
+            case 'n':
+                size_count = bench_list(optarg, sizes);
+                break;
+            case 't':
+                thread_count = bench_list(optarg, threads);
+                break;
+            case 'D':
+                degree = atoi(optarg);
+                break;
+            case 'w':
+                warmup = atoi(optarg);
+                break;
+            case 'r':
+                trials = atoi(optarg);
+                break;
+            case 'm':
+                m = atoi(optarg);
+                break;
+            case OPT_DIR:
+                dir = optarg;
+                break;
+            case OPT_SEED:
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'h':
+                bench_help(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if(model_count == 0 || degree < 1 || warmup < 0 || trials < 1 || m < 1){
+        fprintf(stderr,"[bench] needs a model, -D >= 1, -w >= 0, -r >= 1 and -m >= 1\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double *parse_times     = xmalloc(trials * sizeof(double), HERE);
+    double *compute_times   = xmalloc(trials * sizeof(double), HERE);
+
+    puts("model\tnodes\tedges\tthreads\tphase\tmedian_s\tp95_s\tmedian_eps\tp95_eps");
+
+    for(int gi = 0; gi<model_count; gi++){
+        for(int si = 0; si<size_count; si++){
+            const char *model   = gen_name(models[gi]);
+            edge_buf *edges     = gen_graph(models[gi], sizes[si], degree, seed);
+            const long lines    = edges->length / 2;
+            char path[4096];
+            int memfd           = -1;
+            FILE *file;
+
+            /**
+             * in memory: the text lives in an anonymous file,
+             * parsed through its /proc path like a real one
+             */
+            if(dir != NULL){
+                snprintf(path, sizeof(path), "%s/bench-%s-%d.txt", dir, model, sizes[si]);
+                file = xfopen(path, "w", HERE);
+            }
+            else{
+                memfd = memfd_create("bench", 0);
+                if(memfd < 0)
+                    error("[memfd_create]", HERE);
+                snprintf(path, sizeof(path), "/proc/self/fd/%d", memfd);
+                file = fdopen(dup(memfd), "w");
+                if(file == NULL)
+                    error("[fdopen]", HERE);
+            }
+            gen_write(file, edges, sizes[si]);
+            xfclose(file, HERE);
+            gen_destroy(edges);
+
+            for(int ti = 0; ti<thread_count; ti++){
+                thread_pool *pool = pool_create(threads[ti]);
+                graph *g = NULL;
+                int iterations = m;
+
+                for(int run = 0; run<warmup + trials; run++){
+                    if(g != NULL)
+                        graph_destroy(g);
+
+                    const double start = bench_clock();
+                    g = graph_parse(path, pool, PARSE_MMAP | SORT_RADIX, false);
+                    if(run >= warmup)
+                        parse_times[run - warmup] = bench_clock() - start;
+                }
+
+                for(int run = 0; run<warmup + trials; run++){
+                    int iter_count = 0;
+
+                    const double start = bench_clock();
+                    double *ranks = pagerank(g, d, 0.0, m, pool, NULL, &iter_count);
+                    if(run >= warmup)
+                        compute_times[run - warmup] = bench_clock() - start;
+                    free(ranks);
+                    iterations = iter_count;
+                }
+
+                bench_print(model, sizes[si], g->edges, threads[ti], "parse", parse_times, trials, (double)lines);
+                bench_print(model, sizes[si], g->edges, threads[ti], "pagerank", compute_times, trials, (double)g->edges * iterations);
+
+                graph_destroy(g);
+                pool_destroy(pool);
+            }
+
+            if(memfd >= 0)
+                close(memfd);
+        }
+    }
+
+    free(parse_times);
+    free(compute_times);
+    return 0;
+}
@@ -11,6 +11,12 @@
 #include "./src/lib_supp.h"
 #include "./src/lib_graph.h"
 #include "./src/lib_pagerank.h"
+#include "./src/lib_threads.h"
+#include "./src/lib_reorder.h"
+#include "./src/lib_ppr.h"
+#include "./src/lib_server.h"
+#include "./src/lib_perf.h"
+#include "./src/lib_external.h"
 
 #define _GNU_SOURCE
 
@@ -26,19 +32,16 @@
 #define CHECK_TIME false
 #endif
 
-#ifndef FORCE_NO_ARGS
-#define FORCE_NO_ARGS false
-#endif
-
 /**
  * global variables shared with signal handler
  */
 double *X_previous;
+float  *Xf_previous;
 pthread_mutex_t signal_mux;
 
 int main(int argc, char *argv[])
 {
-    struct timeval start,end,parse_start,parse_end,page_start,page_end;
+    struct timeval start,end,parse_start,parse_end,reorder_start,reorder_end,page_start,page_end;
     /**Time measure struct */
     xgettimeofday(&start,CHECK_TIME,HERE);
 
@@ -49,70 +52,315 @@ int main(int argc, char *argv[])
     int threads = 3;
     // stored true
     bool signal = false;
+    int parse_mode = PARSE_MMAP;
+    int sort_mode = SORT_RADIX;
+    int reorder = REORDER_NONE;
+    pagerank_opts opts = {.schedule = SCHED_EDGES, .kernel = KERNEL_AUTO, .precision = PREC_DOUBLE, .solver = SOLVER_JACOBI, .adaptive = 0.0, .extrapolate = EXTRAP_NONE, .direction = DIR_PULL, .teleport = NULL, .init = NULL, .report = NULL, .metrics = NULL};
     char *infile = NULL;
+    char *snapshot = NULL;
+    char *teleport_file = NULL;
+    char *batch_file = NULL;
+    int batch_size = PPR_BATCH;
+    char *delta_file = NULL;
+    char *warm_file = NULL;
+    char *ranks_file = NULL;
+    char *serve_path = NULL;
+    char *perf_file = NULL;
+    char *metrics_file = NULL;
+    bool compress = false;
+    char *shards_file = NULL;
+    long shard_mb = SHARD_MB;
+    bool external = false;
 
-    if(FORCE_NO_ARGS){
-        e = 1e-4;
-        threads = 8;
-        infile = "test/web-hudong.mtx";
-    }
-    
     /**
      * Parameter parsing from argv
      */
-    else{
-        int opt;
-        while ((opt = getopt(argc, argv, "shk:m:d:e:t:")) != -1)
+    /**
+     * long only options for the execution modes
+     */
+    enum {OPT_PARSE = 256, OPT_SORT, OPT_SCHEDULE, OPT_KERNEL, OPT_REORDER, OPT_SOLVER, OPT_ADAPTIVE, OPT_EXTRAPOLATE, OPT_TELEPORT, OPT_BATCH, OPT_BATCH_SIZE, OPT_DELTA, OPT_WARM, OPT_SAVE_RANKS, OPT_SERVE, OPT_PERF, OPT_METRICS, OPT_COMPRESS, OPT_SHARDS, OPT_SHARD_MB, OPT_DIRECTION, OPT_BALANCE};
+    static struct option long_opts[] = {
+        {"parse",   required_argument,  NULL,   OPT_PARSE},
+        {"sort",    required_argument,  NULL,   OPT_SORT},
+        {"schedule",required_argument,  NULL,   OPT_SCHEDULE},
+        {"kernel",  required_argument,  NULL,   OPT_KERNEL},
+        {"reorder", required_argument,  NULL,   OPT_REORDER},
+        {"solver",  required_argument,  NULL,   OPT_SOLVER},
+        {"adaptive",required_argument,  NULL,   OPT_ADAPTIVE},
+        {"extrapolate",required_argument,NULL,  OPT_EXTRAPOLATE},
+        {"teleport",required_argument,  NULL,   OPT_TELEPORT},
+        {"batch",   required_argument,  NULL,   OPT_BATCH},
+        {"batch-size",required_argument,NULL,   OPT_BATCH_SIZE},
+        {"delta",   required_argument,  NULL,   OPT_DELTA},
+        {"warm",    required_argument,  NULL,   OPT_WARM},
+        {"save-ranks",required_argument,NULL,   OPT_SAVE_RANKS},
+        {"serve",   required_argument,  NULL,   OPT_SERVE},
+        {"perf",    required_argument,  NULL,   OPT_PERF},
+        {"metrics", required_argument,  NULL,   OPT_METRICS},
+        {"compress",no_argument,        NULL,   OPT_COMPRESS},
+        {"shards",  required_argument,  NULL,   OPT_SHARDS},
+        {"shard-mb",required_argument,  NULL,   OPT_SHARD_MB},
+        {"direction",required_argument, NULL,   OPT_DIRECTION},
+        {"balance", no_argument,        NULL,   OPT_BALANCE},
+        {NULL,      0,                  NULL,   0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "shk:m:d:e:t:o:p:", long_opts, NULL)) != -1)
+    {
+        switch (opt)
         {
-            switch (opt)
-            {
-            case 'k':
-                k = atoi(optarg);
-                break;
-            case 'm':
-                m = atoi(optarg);
-                break;
-            case 'd':
-                d = atof(optarg);
-                break;
-            case 'e':
-                e = atof(optarg);
-                break;
-            case 't':
-                threads = atoi(optarg);
-                break;
-            case 's':
-                signal = false;
-                break;
-            case 'h':
-                printHelp(argv[0]);
-                exit(EXIT_SUCCESS);
-            default: /* '?' */
+        case 'k':
+            k = atoi(optarg);
+            break;
+        case 'm':
+            m = atoi(optarg);
+            break;
+        case 'd':
+            d = atof(optarg);
+            break;
+        case 'e':
+            e = atof(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'o':
+            snapshot = optarg;
+            break;
+        case 'p':
+            if(strcmp(optarg,"double") == 0)
+                opts.precision = PREC_DOUBLE;
+            else if(strcmp(optarg,"float") == 0)
+                opts.precision = PREC_FLOAT;
+            else if(strcmp(optarg,"mixed") == 0)
+                opts.precision = PREC_MIXED;
+            else{
+                fprintf(stderr,"[pagerank] unknown precision: %s\n",optarg);
                 exit(EXIT_FAILURE);
             }
+            break;
+        case 's':
+            signal = true;
+            break;
+        case OPT_PARSE:
+            if(strcmp(optarg,"mmap") == 0)
+                parse_mode = PARSE_MMAP;
+            else if(strcmp(optarg,"stream") == 0)
+                parse_mode = PARSE_STREAM;
+            else{
+                fprintf(stderr,"[pagerank] unknown parse mode: %s\n",optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_SORT:
+            if(strcmp(optarg,"radix") == 0)
+                sort_mode = SORT_RADIX;
+            else if(strcmp(optarg,"qsort") == 0)
+                sort_mode = SORT_QSORT;
+            else{
+                fprintf(stderr,"[pagerank] unknown sort mode: %s\n",optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_SCHEDULE:
+            if(strcmp(optarg,"edges") == 0)
+                opts.schedule = SCHED_EDGES;
+            else if(strcmp(optarg,"nodes") == 0)
+                opts.schedule = SCHED_NODES;
+            else if(strcmp(optarg,"dynamic") == 0)
+                opts.schedule = SCHED_DYNAMIC;
+            else{
+                fprintf(stderr,"[pagerank] unknown schedule: %s\n",optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_KERNEL:
+            if(strcmp(optarg,"auto") == 0)
+                opts.kernel = KERNEL_AUTO;
+            else if(strcmp(optarg,"scalar") == 0)
+                opts.kernel = KERNEL_SCALAR;
+            else if(strcmp(optarg,"avx2") == 0)
+                opts.kernel = KERNEL_AVX2;
+            else if(strcmp(optarg,"avx512") == 0)
+                opts.kernel = KERNEL_AVX512;
+            else{
+                fprintf(stderr,"[pagerank] unknown kernel: %s\n",optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_REORDER:
+            if(strcmp(optarg,"none") == 0)
+                reorder = REORDER_NONE;
+            else if(strcmp(optarg,"degree") == 0)
+                reorder = REORDER_DEGREE;
+            else if(strcmp(optarg,"rcm") == 0)
+                reorder = REORDER_RCM;
+            else{
+                fprintf(stderr,"[pagerank] unknown reorder mode: %s\n",optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_SOLVER:
+            if(strcmp(optarg,"jacobi") == 0)
+                opts.solver = SOLVER_JACOBI;
+            else if(strcmp(optarg,"gauss-seidel") == 0 || strcmp(optarg,"gs") == 0)
+                opts.solver = SOLVER_GS;
+            else{
+                fprintf(stderr,"[pagerank] unknown solver: %s\n",optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_ADAPTIVE:
+            opts.adaptive = atof(optarg);
+            break;
+        case OPT_EXTRAPOLATE:
+            if(strcmp(optarg,"none") == 0)
+                opts.extrapolate = EXTRAP_NONE;
+            else if(strcmp(optarg,"aitken") == 0)
+                opts.extrapolate = EXTRAP_AITKEN;
+            else if(strcmp(optarg,"quadratic") == 0)
+                opts.extrapolate = EXTRAP_QUADRATIC;
+            else{
+                fprintf(stderr,"[pagerank] unknown extrapolation: %s\n",optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_TELEPORT:
+            teleport_file = optarg;
+            break;
+        case OPT_BATCH:
+            batch_file = optarg;
+            break;
+        case OPT_BATCH_SIZE:
+            batch_size = atoi(optarg);
+            break;
+        case OPT_DELTA:
+            delta_file = optarg;
+            break;
+        case OPT_WARM:
+            warm_file = optarg;
+            break;
+        case OPT_SAVE_RANKS:
+            ranks_file = optarg;
+            break;
+        case OPT_SERVE:
+            serve_path = optarg;
+            break;
+        case OPT_PERF:
+            perf_file = optarg;
+            break;
+        case OPT_METRICS:
+            metrics_file = optarg;
+            break;
+        case OPT_COMPRESS:
+            compress = true;
+            break;
+        case OPT_SHARDS:
+            shards_file = optarg;
+            break;
+        case OPT_SHARD_MB:
+            shard_mb = atol(optarg);
+            break;
+        case OPT_DIRECTION:
+            if(strcmp(optarg,"pull") == 0)
+                opts.direction = DIR_PULL;
+            else if(strcmp(optarg,"push") == 0)
+                opts.direction = DIR_PUSH;
+            else if(strcmp(optarg,"auto") == 0)
+                opts.direction = DIR_AUTO;
+            else{
+                fprintf(stderr,"[pagerank] unknown direction: %s\n",optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_BALANCE:
+            opts.report = stderr;
+            break;
+        case 'h':
+            printHelp(argv[0]);
+            exit(EXIT_SUCCESS);
+        default: /* '?' */
+            exit(EXIT_FAILURE);
         }
-        
-        if (optind >= argc)
-        {
-            puts("[pagerank] no input file");
-            puts("usage: ./pagerank [-h] [-k K] [-m M] [-d D] [-e E] [-t T] <infile>");
-            return -1;
-        }
+    }
+    
+    if (optind >= argc)
+    {
+        puts("[pagerank] no input file");
+        puts("usage: ./pagerank [-h] [-k K] [-m M] [-d D] [-e E] [-t T] [-p P] [-o SNAPSHOT] <infile>");
+        return -1;
+    }
 
-        infile = argv[optind];
+    infile = argv[optind];
 
+    if(k < 0){
+        fprintf(stderr,"[pagerank] -k must be >= 0\n");
+        exit(EXIT_FAILURE);
     }
 
-    if(infile == NULL){
-        puts("./testbench: error in force-args");
-        return -1;
+    if(opts.solver == SOLVER_GS && opts.precision != PREC_DOUBLE){
+        fprintf(stderr,"[pagerank] gauss-seidel supports only -p double\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(opts.adaptive > 0.0 && (opts.solver != SOLVER_JACOBI || opts.precision == PREC_FLOAT)){
+        fprintf(stderr,"[pagerank] --adaptive needs the jacobi solver and -p double or mixed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(opts.extrapolate != EXTRAP_NONE && (opts.solver != SOLVER_JACOBI || opts.precision == PREC_FLOAT || opts.adaptive > 0.0)){
+        fprintf(stderr,"[pagerank] --extrapolate needs the jacobi solver, -p double or mixed and no --adaptive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(batch_file != NULL && (teleport_file != NULL || batch_size < 1 || opts.solver != SOLVER_JACOBI ||
+        opts.precision != PREC_DOUBLE || opts.adaptive > 0.0 || opts.extrapolate != EXTRAP_NONE)){
+        fprintf(stderr,"[pagerank] --batch runs jacobi in double only, with --batch-size >= 1 and no --teleport\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(serve_path != NULL && (batch_file != NULL || ranks_file != NULL)){
+        fprintf(stderr,"[pagerank] --serve doesn't support --batch and --save-ranks\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(compress && (opts.solver != SOLVER_JACOBI || batch_file != NULL)){
+        fprintf(stderr,"[pagerank] --compress needs the jacobi solver and no --batch\n");
+        exit(EXIT_FAILURE);
     }
 
+    if(opts.direction != DIR_PULL && (opts.solver != SOLVER_JACOBI || opts.precision != PREC_DOUBLE || opts.adaptive > 0.0 || batch_file != NULL)){
+        fprintf(stderr,"[pagerank] --direction push/auto needs the jacobi solver, -p double, no --adaptive and no --batch\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(batch_file != NULL && (warm_file != NULL || ranks_file != NULL)){
+        fprintf(stderr,"[pagerank] --warm and --save-ranks don't apply to --batch\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(shard_mb < 1 || (shards_file != NULL && compress)){
+        fprintf(stderr,"[pagerank] --shard-mb must be >= 1, --shards doesn't support --compress\n");
+        exit(EXIT_FAILURE);
+    }
+
+    //semi-external mode: the input is a shard file (--shards)
+    external = shards_is_file(infile);
+    if(external && (opts.solver != SOLVER_JACOBI || opts.precision != PREC_DOUBLE || opts.adaptive > 0.0 ||
+        opts.extrapolate != EXTRAP_NONE || teleport_file != NULL || batch_file != NULL || delta_file != NULL ||
+        serve_path != NULL || snapshot != NULL || shards_file != NULL || reorder != REORDER_NONE || compress)){
+        fprintf(stderr,"[pagerank] a shard file runs jacobi in double only, with uniform teleport and without graph edits\n");
+        exit(EXIT_FAILURE);
+    }
+
+
     int iter_count = 0;
 
     int graph_nodes = -1;
 
     pthread_t signal_tid;
+    sig_handler_attr handler_attr;
 
     /**
      * Setup thread that handles all signals
@@ -124,9 +372,9 @@ int main(int argc, char *argv[])
     {
         sigset_t local_mask;
         sigfillset(&local_mask);
-        sig_handler_attr handler_attr;
         handler_attr.signal_stream  = SIGNAL_STREAM;
         handler_attr.X_previous     = &X_previous;
+        handler_attr.Xf_previous    = &Xf_previous;
         handler_attr.shared_mux     = &signal_mux;
         handler_attr.nodes          = &graph_nodes;
         handler_attr.iter_count     = &iter_count;
@@ -142,20 +390,219 @@ int main(int argc, char *argv[])
      * a graph struct;
      */
 
+    /**
+     * one pool of workers, reused by all the phases
+     */
+    thread_pool *pool = pool_create(threads);
+
+    /**
+     * counters on the main thread and on the workers of
+     * the pool (the threads that exist now)
+     */
+    FILE *perf_stream = NULL;
+    if(perf_file != NULL){
+        perf_stream = fopen(perf_file, "w");
+        if(perf_stream == NULL){
+            fprintf(stderr,"[pagerank] cannot open %s\n",perf_file);
+            exit(EXIT_FAILURE);
+        }
+        perf = perf_open(perf_stream);
+    }
+
+    //per iteration telemetry (a path, /dev/fd/N for a descriptor)
+    FILE *metrics_stream = NULL;
+    if(metrics_file != NULL){
+        metrics_stream = fopen(metrics_file, "w");
+        if(metrics_stream == NULL){
+            fprintf(stderr,"[pagerank] cannot open %s\n",metrics_file);
+            exit(EXIT_FAILURE);
+        }
+        opts.metrics = metrics_stream;
+    }
+
     xgettimeofday(&parse_start,CHECK_TIME,HERE);
-    graph *g    = graph_parse(infile, threads,CHECK_TIME);
+    graph *g    = external ? shards_info(infile) : graph_parse(infile, pool, parse_mode | sort_mode, CHECK_TIME);
     xgettimeofday(&parse_end,CHECK_TIME,HERE);
 
+    if(perf != NULL)
+        perf_phase(perf, "parse");
+
+    /**
+     * incremental update: the edits are applied to the
+     * parsed (or mapped) graph, usually with --warm
+     */
+    if(delta_file != NULL){
+        graph *r = graph_apply_delta(g, delta_file, CHECK_TIME);
+        graph_destroy(g);
+        g = r;
+
+        if(perf != NULL)
+            perf_phase(perf, "delta");
+    }
+
     printGraphInfo(g,INFO_STREAM, false);
 
-    xgettimeofday(&page_start,CHECK_TIME,HERE);
-    double *ranks = pagerank(g, d, e, m, threads, &iter_count);
-    xgettimeofday(&page_end,CHECK_TIME,HERE);
+    if(snapshot != NULL)
+        graph_snapshot_save(snapshot, g);
+
+    if(shards_file != NULL)
+        shards_save(shards_file, g, (size_t)shard_mb << 20);
+
+    /**
+     * optional relabeling for cache locality: pagerank
+     * runs on the reordered graph, the ranks are mapped
+     * back to the original ids before the stats
+     */
+    int *perm = NULL;
+    xgettimeofday(&reorder_start,CHECK_TIME,HERE);
+    if(reorder != REORDER_NONE){
+        graph *r = graph_reorder(g, reorder, pool, &perm, CHECK_TIME);
+        graph_destroy(g);
+        g = r;
+    }
+    xgettimeofday(&reorder_end,CHECK_TIME,HERE);
+
+    if(perf != NULL && reorder != REORDER_NONE)
+        perf_phase(perf, "reorder");
+
+    /**
+     * warm start from the ranks of a previous run (saved
+     * with the original ids)
+     */
+    double *warm = NULL;
+    if(warm_file != NULL)
+        warm = ranks_load(warm_file, g->nodes);
+
+    if(perm != NULL && warm != NULL){
+        double *w = xmalloc(g->nodes * sizeof(double), HERE);
+        for(int v = 0; v<g->nodes; v++)
+            w[v] = warm[perm[v]];
+        free(warm);
+        warm = w;
+    }
+
+    opts.init = warm;
+
+    //the signal handler scans the vectors of this graph
+    xpthread_mutex_lock(&signal_mux, HERE);
+        graph_nodes = g->nodes;
+    xpthread_mutex_unlock(&signal_mux, HERE);
+
+    /**
+     * personalization: seed ids are in the original
+     * labels, mapped onto the reordered graph
+     */
+    seed_sets *seeds = NULL;
+    if(teleport_file != NULL || batch_file != NULL){
+        seeds = seeds_parse((batch_file != NULL) ? batch_file : teleport_file, g->nodes, batch_file == NULL);
+        if(perm != NULL)
+            seeds_relabel(seeds, perm, g->nodes);
+    }
+
+    //last edit of the graph: from here on only the X phase reads the in-lists
+    if(compress){
+        //push reads the out-lists, built from the plain in-lists
+        if(opts.direction != DIR_PULL)
+            graph_build_out(g, pool);
+        graph_compress(g, pool, CHECK_TIME);
+
+        if(perf != NULL)
+            perf_phase(perf, "compress");
+    }
+
+    if(serve_path != NULL){
+        /**
+         * server mode: the graph stays resident, every
+         * computation runs in the background of the queries
+         */
+        if(seeds != NULL)
+            opts.teleport = seeds_vector(seeds, 0, g->nodes);
+
+        rank_server srv;
+        srv.g           = g;
+        srv.pool        = pool;
+        srv.perm        = perm;
+        srv.opts        = opts;
+        srv.dumping     = d;
+        srv.epsilon     = e;
+        srv.max_iter    = m;
+        srv.log         = stderr;
+
+        xgettimeofday(&page_start,CHECK_TIME,HERE);
+        server_run(&srv, serve_path);
+        xgettimeofday(&page_end,CHECK_TIME,HERE);
+
+        if(perf != NULL)
+            perf_phase(perf, "serve");
+
+        free(perm);
+        free((double *)opts.teleport);
+    }
+    else if(batch_file != NULL){
+        xgettimeofday(&page_start,CHECK_TIME,HERE);
+        for(int first = 0; first<seeds->count; first += batch_size){
+            const int count = (seeds->count - first < batch_size) ? seeds->count - first : batch_size;
+            double error    = 0.0;
+            double *X       = pagerank_batch(g, d, e, m, pool, seeds, first, count, &iter_count, &error);
+
+            for(int b = 0; b<count; b++){
+                double *ranks = pagerank_batch_column(X, g->nodes, count, b);
+                if(perm != NULL)
+                    ranks = reorder_ranks(ranks, perm, g->nodes);
+
+                fprintf(INFO_STREAM, "Seed set %d\n", first + b);
+                printStats(ranks, g->nodes, iter_count, m, error, k, pool, INFO_STREAM);
+                free(ranks);
+            }
+            free(X);
+        }
+        xgettimeofday(&page_end,CHECK_TIME,HERE);
+        free(perm);
+
+        if(perf != NULL)
+            perf_phase(perf, "batch");
+    }
+    else{
+        if(seeds != NULL)
+            opts.teleport = seeds_vector(seeds, 0, g->nodes);
+
+        xgettimeofday(&page_start,CHECK_TIME,HERE);
+        double *ranks = external ? pagerank_external(infile, d, e, m, pool, &opts, &iter_count) : pagerank(g, d, e, m, pool, &opts, &iter_count);
+        xgettimeofday(&page_end,CHECK_TIME,HERE);
+
+        if(perf != NULL)
+            perf_phase(perf, "pagerank");
+
+        if(perm != NULL){
+            ranks = reorder_ranks(ranks, perm, g->nodes);
+            free(perm);
+        }
+
+        if(ranks_file != NULL)
+            ranks_save(ranks_file, ranks, g->nodes);
+
+        printStats(ranks, g->nodes, iter_count, m, opts.error, k, pool, INFO_STREAM);
+        free(ranks);
+
+        if(perf != NULL)
+            perf_phase(perf, "stats");
+        free((double *)opts.teleport);
+    }
 
-    printStats(ranks, g->nodes, iter_count, m, k, INFO_STREAM);
+    free(warm);
 
+    if(seeds != NULL)
+        seeds_destroy(seeds);
     graph_destroy(g);
-    free(ranks);
+    pool_destroy(pool);
+
+    if(metrics_stream != NULL)
+        fclose(metrics_stream);
+
+    if(perf != NULL){
+        perf_close(perf);
+        fclose(perf_stream);
+    }
 
     if(signal){
         pthread_kill(signal_tid,SIGUSR2);
@@ -169,6 +616,8 @@ int main(int argc, char *argv[])
     if(CHECK_TIME){
         fprintf(stderr,"\n--------------------\nTime Stats: %s\n--------------------\n",infile);
         fprintf(stderr,"parsing\ttime\t\t%.6f sec\n",exctract_time(parse_start,parse_end,CHECK_TIME));
+        if(reorder != REORDER_NONE)
+            fprintf(stderr,"reorder\ttime\t\t%.6f sec\n",exctract_time(reorder_start,reorder_end,CHECK_TIME));
         fprintf(stderr,"compute\ttime\t\t%.6f sec\n",exctract_time(page_start,page_end,CHECK_TIME));
         fprintf(stderr,"total\ttime\t\t%.6f sec\n",exctract_time(start,end,CHECK_TIME));
     }
@@ -0,0 +1,493 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include "lib_external.h"
+#include "lib_kernels.h"
+#include "lib_supp.h"
+
+#define HERE __FILE__,__LINE__
+
+//nodes per task of the parallel loops
+#define EXTERNAL_CHUNK 4096
+
+static double external_clock(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t shard_round(uint64_t bytes){
+    return (bytes + SHARD_ALIGN - 1) / SHARD_ALIGN * SHARD_ALIGN;
+}
+
+static uint64_t shard_payload(int64_t count, int64_t edges){
+    return (count + 1) * sizeof(edge_t) + edges * sizeof(int);
+}
+
+bool shards_is_file(const char *path){
+    char magic[sizeof(SHARDS_MAGIC)];
+    bool ret = false;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode)){
+        if(read(fd, magic, sizeof(magic)) == sizeof(magic))
+            ret = (memcmp(magic, SHARDS_MAGIC, sizeof(magic)) == 0);
+    }
+    xclose(fd,HERE);
+    return ret;
+}
+
+static void shards_write(FILE *file, const void *ptr, size_t size, size_t count){
+    if(fwrite(ptr, size, count, file) != count)
+        error("[shards_save] fwrite",HERE);
+}
+
+static void shards_pad(FILE *file, uint64_t bytes){
+    static const char zero[SHARD_ALIGN];
+    shards_write(file, zero, 1, bytes);
+}
+
+void shards_save(const char *path, const graph *g, size_t shard_bytes){
+    if(g->sources == NULL)
+        error("[shards_save] compressed graph",HERE);
+
+    //cut points: a shard ends when the next node would exceed shard_bytes
+    int size = 16;
+    int64_t shards = 0;
+    shard_entry *table = xmalloc(size * sizeof(shard_entry), HERE);
+
+    for(int first = 0; first<g->nodes; ){
+        int last = first + 1;
+        while(last < g->nodes && shard_payload(last + 1 - first, g->offsets[last + 1] - g->offsets[first]) <= shard_bytes)
+            last++;
+
+        if(shards == size){
+            size   *= 2;
+            table   = xrealloc(table, size * sizeof(shard_entry), HERE);
+        }
+        table[shards].first = first;
+        table[shards].last  = last;
+        table[shards].edges = g->offsets[last] - g->offsets[first];
+        table[shards].bytes = shard_round(shard_payload(last - first, table[shards].edges));
+        shards++;
+        first = last;
+    }
+
+    shards_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SHARDS_MAGIC, sizeof(SHARDS_MAGIC));
+    header.version      = SHARDS_VERSION;
+    header.edge_bytes   = sizeof(edge_t);
+    header.nodes        = g->nodes;
+    header.edges        = g->edges;
+    header.dead_count   = g->dead_count;
+    header.shards       = shards;
+
+    const uint64_t meta = sizeof(header) + shards * sizeof(shard_entry) + (uint64_t)g->nodes * sizeof(int);
+    uint64_t offset     = shard_round(meta);
+    for(int64_t k = 0; k<shards; k++){
+        table[k].offset = offset;
+        offset         += table[k].bytes;
+    }
+
+    FILE *file = xfopen(path,"wb",HERE);
+    shards_write(file, &header, sizeof(header), 1);
+    shards_write(file, table, sizeof(shard_entry), shards);
+    shards_write(file, g->out, sizeof(int), g->nodes);
+    shards_pad(file, shard_round(meta) - meta);
+
+    edge_t *local = NULL;
+    int local_size = 0;
+    for(int64_t k = 0; k<shards; k++){
+        const int first = (int)table[k].first;
+        const int count = (int)(table[k].last - table[k].first);
+
+        if(count + 1 > local_size){
+            local_size  = count + 1;
+            local       = xrealloc(local, local_size * sizeof(edge_t), HERE);
+        }
+        for(int i = 0; i<=count; i++)
+            local[i] = g->offsets[first + i] - g->offsets[first];
+
+        shards_write(file, local, sizeof(edge_t), count + 1);
+        shards_write(file, g->sources + g->offsets[first], sizeof(int), table[k].edges);
+        shards_pad(file, table[k].bytes - shard_payload(count, table[k].edges));
+    }
+
+    free(local);
+    xfclose(file,HERE);
+
+    fprintf(stderr, "Shards: %ld of about %zu bytes written to %s\n", (long)shards, shard_bytes, path);
+    free(table);
+}
+
+static void shards_read_header(int fd, shards_header *header){
+    if(pread(fd, header, sizeof(*header), 0) != sizeof(*header))
+        error("[shards] truncated shard file",HERE);
+    if(memcmp(header->magic, SHARDS_MAGIC, sizeof(SHARDS_MAGIC)) != 0)
+        error("[shards] not a shard file",HERE);
+    if(header->version != SHARDS_VERSION)
+        error("[shards] unsupported shard file version",HERE);
+    if(header->edge_bytes != sizeof(edge_t))
+        error("[shards] shard file built with different index sizes",HERE);
+    if(header->nodes < 1 || header->nodes > INT_MAX || header->edges < 0 || header->edges > (int64_t)EDGE_MAX ||
+        header->shards < 1 || header->shards > header->nodes)
+        error("[shards] bad header",HERE);
+}
+
+graph *shards_info(const char *path){
+    shards_header header;
+    int fd = xopen((char *)path, O_RDONLY, HERE);
+
+    shards_read_header(fd, &header);
+    xclose(fd,HERE);
+
+    graph *g        = xcalloc(1, sizeof(graph), HERE);
+    g->nodes        = (int)header.nodes;
+    g->edges        = (long)header.edges;
+    g->dead_count   = (int)header.dead_count;
+    return g;
+}
+
+/**
+ * reader thread and the two buffers: slot s is free
+ * (full[s] false) or holds the shard of the sequence
+ * number seq[s]. The reader fills the sequence 0, 1, 2, ...
+ * (shard seq % shards) in slot seq % 2, the compute side
+ * takes them in the same order
+ */
+typedef struct external_reader{
+    int                 fd;
+    bool                direct;
+    const shard_entry   *table;
+    int                 shards;
+    int                 nodes;
+    uint8_t             *buffer[2];
+    bool                full[2];
+    long                seq[2];
+    double              read_time[2];   //pread time of the shard held
+    bool                stop;
+    pthread_mutex_t     mux;
+    pthread_cond_t      cond;
+}external_reader;
+
+static void external_pread(external_reader *r, uint8_t *buff, uint64_t bytes, uint64_t offset){
+    uint64_t done = 0;
+
+    while(done < bytes){
+        const size_t step = (bytes - done > (1u << 30)) ? (1u << 30) : (size_t)(bytes - done);
+        const ssize_t got = pread(r->fd, buff + done, step, offset + done);
+
+        //some file systems accept O_DIRECT in open() only
+        if(got < 0 && errno == EINVAL && r->direct){
+            fcntl(r->fd, F_SETFL, fcntl(r->fd, F_GETFL) & ~O_DIRECT);
+            r->direct = false;
+            continue;
+        }
+        if(got < 0 && errno == EINTR)
+            continue;
+        if(got <= 0)
+            error("[pagerank_external] pread: truncated shard file",HERE);
+        done += got;
+    }
+
+    if(!r->direct)
+        posix_fadvise(r->fd, offset, bytes, POSIX_FADV_DONTNEED);
+}
+
+/**
+ * shard_check()
+ * -------------
+ * the shard just read, before the pool gathers on it: the
+ * local offsets go from 0 to `edges` without decreasing and
+ * every source is a node. It runs on the reader thread, so
+ * it overlaps the computation of the previous shard
+ */
+static void shard_check(const shard_entry *s, const uint8_t *buff, int nodes){
+    const int count         = (int)(s->last - s->first);
+    const edge_t *offsets   = (const edge_t *)buff;
+    const int *sources      = (const int *)(offsets + count + 1);
+    bool ok = (offsets[0] == 0 && offsets[count] == s->edges);
+
+    for(int i = 0; i<count && ok; i++)
+        ok = (offsets[i] <= offsets[i+1]);
+
+    //unsigned compare: negative ids fail too
+    unsigned bad = 0;
+    for(int64_t j = 0; j<s->edges; j++)
+        bad |= ((unsigned)sources[j] >= (unsigned)nodes);
+
+    if(!ok || bad)
+        error("[pagerank_external] corrupt shard",HERE);
+}
+
+static void *external_reader_routine(void *attr){
+    external_reader *r = (external_reader *)attr;
+
+    for(long seq = 0; ; seq++){
+        const int slot = seq % 2;
+
+        xpthread_mutex_lock(&(r->mux), HERE);
+            while(r->full[slot] && !r->stop)
+                xpthread_cond_wait(&(r->cond), &(r->mux), HERE);
+            const bool stop = r->stop;
+        xpthread_mutex_unlock(&(r->mux), HERE);
+
+        if(stop)
+            break;
+
+        const shard_entry *s = &(r->table[seq % r->shards]);
+        const double start = external_clock();
+        external_pread(r, r->buffer[slot], s->bytes, s->offset);
+        const double time = external_clock() - start;
+
+        shard_check(s, r->buffer[slot], r->nodes);
+
+        xpthread_mutex_lock(&(r->mux), HERE);
+            r->seq[slot]        = seq;
+            r->read_time[slot]  = time;
+            r->full[slot]       = true;
+            xpthread_cond_broadcast(&(r->cond), HERE);
+        xpthread_mutex_unlock(&(r->mux), HERE);
+    }
+
+    return NULL;
+}
+
+/**
+ * state of an iteration shared by the parallel for bodies
+ */
+typedef struct external_attr{
+    const int       *out;
+    const double    *X_prev;
+    double          *X_curr;
+    double          *Y;
+    gather_fn       gather;
+    const edge_t    *offsets;       //current shard, local
+    const int       *sources;
+    int             first;          //first node of the shard
+    double          dumping_factor;
+    double          jump;
+    double          error;
+    double          S_t;
+    pthread_mutex_t mux;            //error and S_t, once per task
+}external_attr;
+
+static void external_y_body(void *attr, int start, int end){
+    external_attr *arg = (external_attr *)attr;
+
+    for(int u = start; u<end; u++)
+        arg->Y[u] = (arg->out[u] > 0) ? arg->X_prev[u] / (double)arg->out[u] : 0.0;
+}
+
+//[start, end) are local nodes of the shard
+static void external_x_body(void *attr, int start, int end){
+    external_attr *arg = (external_attr *)attr;
+    double *X_curr = arg->X_curr + arg->first;
+    const double *X_prev = arg->X_prev + arg->first;
+    const int *out = arg->out + arg->first;
+    double my_error = 0.0;
+    double my_S_t   = 0.0;
+
+    arg->gather(arg->offsets, arg->sources, arg->Y, X_curr + start, start, end);
+
+    for(int i = start; i<end; i++){
+        X_curr[i] = arg->jump + arg->dumping_factor * X_curr[i];
+
+        if(out[i] == 0)
+            my_S_t += X_curr[i];
+        my_error += fabs(X_curr[i] - X_prev[i]);
+    }
+
+    xpthread_mutex_lock(&(arg->mux), HERE);
+        arg->error  += my_error;
+        arg->S_t    += my_S_t;
+    xpthread_mutex_unlock(&(arg->mux), HERE);
+}
+
+double *pagerank_external(const char *path, double dumping, double eps, int max_iter, thread_pool *pool, pagerank_opts *opts, int *iter_count){
+    external_reader r;
+    shards_header header;
+
+    //metadata through a plain descriptor: O_DIRECT wants aligned reads
+    int meta_fd = xopen((char *)path, O_RDONLY, HERE);
+    shards_read_header(meta_fd, &header);
+
+    const int nodes     = (int)header.nodes;
+    const int shards    = (int)header.shards;
+    const uint64_t meta = sizeof(header) + shards * sizeof(shard_entry) + (uint64_t)nodes * sizeof(int);
+    shard_entry *table  = xmalloc(shards * sizeof(shard_entry), HERE);
+    int *out            = xmalloc(nodes * sizeof(int), HERE);
+
+    if( pread(meta_fd, table, shards * sizeof(shard_entry), sizeof(header)) != (ssize_t)(shards * sizeof(shard_entry)) ||
+        pread(meta_fd, out, nodes * sizeof(int), sizeof(header) + shards * sizeof(shard_entry)) != (ssize_t)(nodes * sizeof(int)))
+        error("[pagerank_external] truncated shard file",HERE);
+
+    struct stat st;
+    if(fstat(meta_fd, &st) != 0)
+        error("[fstat] shard file",HERE);
+    xclose(meta_fd,HERE);
+
+    uint64_t max_bytes = 0;
+    for(int k = 0; k<shards; k++){
+        const shard_entry *s = &(table[k]);
+        if(s->first != ((k == 0) ? 0 : table[k-1].last) || s->last <= s->first || s->last > nodes || s->edges < 0 ||
+            s->offset % SHARD_ALIGN != 0 || s->bytes % SHARD_ALIGN != 0 || s->offset < meta ||
+            s->bytes < shard_payload(s->last - s->first, s->edges) || s->offset + s->bytes > (uint64_t)st.st_size)
+            error("[pagerank_external] bad shard table",HERE);
+        if(s->bytes > max_bytes)
+            max_bytes = s->bytes;
+    }
+    if(table[shards - 1].last != nodes)
+        error("[pagerank_external] bad shard table",HERE);
+
+    r.fd        = open(path, O_RDONLY | O_DIRECT);
+    r.direct    = (r.fd >= 0);
+    if(r.fd < 0)
+        r.fd = xopen((char *)path, O_RDONLY, HERE);
+    posix_fadvise(r.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    r.table     = table;
+    r.shards    = shards;
+    r.nodes     = nodes;
+    r.stop      = false;
+    for(int s = 0; s<2; s++){
+        r.buffer[s]     = xaligned_alloc(SHARD_ALIGN, max_bytes, HERE);
+        r.full[s]       = false;
+        r.seq[s]        = -1;
+        r.read_time[s]  = 0.0;
+    }
+    xpthread_mutex_init(&(r.mux), HERE);
+    xpthread_cond_init(&(r.cond), HERE);
+
+    double *X_previous  = xmalloc(nodes * sizeof(double), HERE);
+    double *X_current   = xmalloc(nodes * sizeof(double), HERE);
+    double *Y           = xmalloc(nodes * sizeof(double), HERE);
+    const double *warm  = (opts != NULL) ? opts->init : NULL;
+    double S_t          = 0.0;
+
+    for(int i = 0; i<nodes; i++){
+        X_previous[i] = (warm != NULL) ? warm[i] : 1.0 / (double)nodes;
+        if(out[i] == 0)
+            S_t += X_previous[i];
+    }
+
+    external_attr arg;
+    arg.out             = out;
+    arg.Y               = Y;
+    arg.gather          = gather_select((opts != NULL) ? opts->kernel : KERNEL_AUTO, NULL);
+    arg.dumping_factor  = dumping;
+    xpthread_mutex_init(&(arg.mux), HERE);
+
+    pthread_t reader;
+    xpthread_create(&reader, external_reader_routine, &r, HERE);
+
+    FILE *metrics   = (opts != NULL) ? opts->metrics : NULL;
+    double error    = 0.0;
+    double io_total = 0.0;
+    double wait_total = 0.0;
+    const double run_start = external_clock();
+    long seq  = 0;
+    int iter  = 0;
+
+    do{
+        const double it_start = external_clock();
+        uint64_t io_bytes   = 0;
+        double io_time      = 0.0;
+        double io_wait      = 0.0;
+
+        arg.X_prev  = X_previous;
+        arg.X_curr  = X_current;
+        arg.jump    = ((1.0 - dumping) + dumping * S_t) / (double)nodes;
+        arg.error   = 0.0;
+        arg.S_t     = 0.0;
+
+        pool_parallel_for(pool, 0, nodes, EXTERNAL_CHUNK, external_y_body, &arg);
+
+        for(int k = 0; k<shards; k++, seq++){
+            const int slot = seq % 2;
+            const double wait_start = external_clock();
+
+            xpthread_mutex_lock(&(r.mux), HERE);
+                while(!(r.full[slot] && r.seq[slot] == seq))
+                    xpthread_cond_wait(&(r.cond), &(r.mux), HERE);
+            xpthread_mutex_unlock(&(r.mux), HERE);
+
+            io_wait    += external_clock() - wait_start;
+            io_time    += r.read_time[slot];
+            io_bytes   += table[k].bytes;
+
+            const int count = (int)(table[k].last - table[k].first);
+            arg.first   = (int)table[k].first;
+            arg.offsets = (const edge_t *)r.buffer[slot];
+            arg.sources = (const int *)(arg.offsets + count + 1);
+
+            pool_parallel_for(pool, 0, count, EXTERNAL_CHUNK, external_x_body, &arg);
+
+            xpthread_mutex_lock(&(r.mux), HERE);
+                r.full[slot] = false;
+                xpthread_cond_broadcast(&(r.cond), HERE);
+            xpthread_mutex_unlock(&(r.mux), HERE);
+        }
+
+        error   = arg.error;
+        S_t     = arg.S_t;
+        iter++;
+
+        io_total    += io_time;
+        wait_total  += io_wait;
+
+        if(metrics != NULL){
+            fprintf(metrics, "{\"iteration\":%d,\"error\":%.10g,\"S_t\":%.10g,\"time\":%.9f,\"io_bytes\":%lu,\"io_time\":%.9f,\"io_wait\":%.9f}\n",
+                iter, error, S_t, external_clock() - it_start, (unsigned long)io_bytes, io_time, io_wait);
+        }
+
+        double *temp    = X_previous;
+        X_previous      = X_current;
+        X_current       = temp;
+    } while(error >= eps && iter < max_iter);
+
+    const double run_time = external_clock() - run_start;
+
+    xpthread_mutex_lock(&(r.mux), HERE);
+        r.stop = true;
+        xpthread_cond_broadcast(&(r.cond), HERE);
+    xpthread_mutex_unlock(&(r.mux), HERE);
+    xpthread_join(reader, NULL, HERE);
+
+    const double mb = (double)seq / shards * (double)(table[shards - 1].offset + table[shards - 1].bytes - table[0].offset) / 1e6;
+    fprintf(stderr, "External: %d shards, %.1f MB read in %.3f s (%.0f MB/s, %s), compute waited %.3f s of %.3f s\n",
+        shards, mb, io_total, (io_total > 0.0) ? mb / io_total : 0.0, r.direct ? "O_DIRECT" : "page cache dropped",
+        wait_total, run_time);
+
+    if(opts != NULL)
+        opts->error = error;
+    *iter_count = iter;
+
+    xpthread_mutex_destroy(&(arg.mux), HERE);
+    xpthread_mutex_destroy(&(r.mux), HERE);
+    xpthread_cond_destroy(&(r.cond), HERE);
+    xclose(r.fd,HERE);
+    free(r.buffer[0]);
+    free(r.buffer[1]);
+    free(table);
+    free(out);
+    free(Y);
+    free(X_current);
+
+    //last iterate
+    return X_previous;
+}
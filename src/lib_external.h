@@ -0,0 +1,102 @@
+#ifndef LIBEXT
+#define LIBEXT
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_graph.h"
+#include "lib_threads.h"
+#include "lib_pagerank.h"
+
+/**
+ * ### Semi-external PageRank
+ * --------------------------
+ * Only the rank vectors and the out degrees stay in memory,
+ * the in-lists are read again from a shard file at every
+ * iteration. The file splits the nodes in shards of
+ * consecutive destinations, each one a CSR of its own
+ * (local offsets, then the sources) starting on a
+ * SHARD_ALIGN boundary:
+ *
+ *      header | shard table | out[nodes] | shard 0 | shard 1 | ...
+ *
+ * pagerank_external() reads the shards with large pread()
+ * calls in a reader thread, in two buffers: the next shard
+ * (shard 0 of the next iteration after the last one) is read
+ * while the pool computes the current one. The file is opened
+ * with O_DIRECT if the file system takes it, otherwise the
+ * pages just read are dropped from the page cache, so the
+ * graph never stays resident.
+ *
+ * Like the snapshot, a shard file loads only in a build with
+ * the same edge_bytes. There is no checksum, the file is read
+ * once per iteration: the shard table is checked against the
+ * file size, and every shard is checked by the reader thread
+ * after each read (local offsets from 0 to `edges`, never
+ * decreasing, sources below `nodes`). A damaged shard stops
+ * the run instead of being gathered out of bounds.
+ */
+#define SHARDS_MAGIC    "PRSHARD"
+#define SHARDS_VERSION  1
+#define SHARD_ALIGN     4096
+
+//default target size of a shard (MB)
+#ifndef SHARD_MB
+#define SHARD_MB 64
+#endif
+
+typedef struct shards_header{
+    char     magic[8];
+    uint32_t version;
+    uint32_t edge_bytes;        //sizeof(edge_t) of the writer
+    int64_t  nodes;
+    int64_t  edges;
+    int64_t  dead_count;
+    int64_t  shards;
+}shards_header;
+
+/**
+ * shard k: destinations [first, last), `bytes` from `offset`
+ * (both multiples of SHARD_ALIGN): last - first + 1 local
+ * offsets (edge_t), `edges` sources (int), zero padding
+ */
+typedef struct shard_entry{
+    int64_t  first;
+    int64_t  last;
+    int64_t  edges;
+    uint64_t offset;
+    uint64_t bytes;
+}shard_entry;
+
+bool shards_is_file(const char *path);
+
+/**
+ * shards_save()
+ * -------------
+ * writes the in-lists of `g` as shards of about
+ * `shard_bytes` (a node is never split, so a shard can be
+ * larger if a single in-list is)
+ */
+void shards_save(const char *path, const graph *g, size_t shard_bytes);
+
+/**
+ * shards_info()
+ * -------------
+ * graph with only nodes, edges and dead ends of a shard
+ * file: no array is loaded, graph_destroy() frees it
+ */
+graph *shards_info(const char *path);
+
+/**
+ * pagerank_external()
+ * -------------------
+ * Jacobi pagerank (double, uniform teleport) streaming the
+ * shard file at `path`. From opts: kernel, init (warm start),
+ * metrics (one JSON line per iteration with the bytes read,
+ * the read time and the time the pool waited for the
+ * reader); error is set on return. A summary of the I/O
+ * goes to stderr. Returns the rank vector
+ */
+double *pagerank_external(const char *path, double dumping, double eps, int max_iter, thread_pool *pool, pagerank_opts *opts, int *iter_count);
+
+#endif
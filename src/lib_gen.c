@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "lib_gen.h"
+#include "lib_supp.h"
+
+#define HERE __FILE__,__LINE__
+
+/**
+ * xorshift64* generator, state never 0
+ */
+static inline uint64_t gen_next(uint64_t *state){
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+//uniform in [0, n)
+static inline int gen_below(uint64_t *state, int n){
+    return (int)((gen_next(state) >> 32) * (uint64_t)n >> 32);
+}
+
+//uniform in [0, 1)
+static inline double gen_unit(uint64_t *state){
+    return (double)(gen_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void gen_push(edge_buf *e, int ori, int dest){
+    if(e->length + 2 > e->size){
+        e->size     = (e->size > 0) ? e->size * 2 : 1024;
+        e->vector   = xrealloc(e->vector, e->size * sizeof(int), HERE);
+    }
+    e->vector[e->length++] = ori;
+    e->vector[e->length++] = dest;
+}
+
+static void gen_rmat(edge_buf *e, int nodes, long count, uint64_t *state){
+    int scale = 0;
+    while((1L << scale) < nodes)
+        scale++;
+
+    for(long i = 0; i<count; i++){
+        int u, v;
+        //points outside [0, nodes) are drawn again
+        do{
+            u = 0;
+            v = 0;
+            for(int b = scale - 1; b>=0; b--){
+                const double p = gen_unit(state);
+                if(p < RMAT_A)
+                    continue;
+                else if(p < RMAT_A + RMAT_B)
+                    v |= 1 << b;
+                else if(p < RMAT_A + RMAT_B + RMAT_C)
+                    u |= 1 << b;
+                else{
+                    u |= 1 << b;
+                    v |= 1 << b;
+                }
+            }
+        } while(u >= nodes || v >= nodes);
+
+        gen_push(e, u, v);
+    }
+}
+
+/**
+ * every edge endpoint is appended to `targets`: a uniform
+ * pick from it is a pick proportional to the degree
+ */
+static void gen_ba(edge_buf *e, int nodes, int degree, uint64_t *state){
+    int *targets    = xmalloc(2 * (size_t)nodes * degree * sizeof(int), HERE);
+    long count      = 0;
+
+    for(int v = 1; v<nodes; v++){
+        const int links = (v < degree) ? v : degree;
+
+        for(int l = 0; l<links; l++){
+            const int dest = (count == 0) ? 0 : targets[gen_below(state, (int)count)];
+            gen_push(e, v, dest);
+            targets[count++] = v;
+            targets[count++] = dest;
+        }
+    }
+
+    free(targets);
+}
+
+static void gen_er(edge_buf *e, int nodes, long count, uint64_t *state){
+    for(long i = 0; i<count; i++)
+        gen_push(e, gen_below(state, nodes), gen_below(state, nodes));
+}
+
+edge_buf *gen_graph(int model, int nodes, int degree, uint64_t seed){
+    if(nodes < 2 || degree < 1)
+        error("[gen_graph] at least 2 nodes and degree 1", HERE);
+
+    edge_buf *e     = xmalloc(sizeof(edge_buf), HERE);
+    uint64_t state  = (seed != 0) ? seed : 0x9E3779B97F4A7C15ULL;
+
+    e->length   = 0;
+    e->size     = 2 * (long)nodes * degree;
+    e->vector   = xmalloc(e->size * sizeof(int), HERE);
+
+    switch(model){
+        case GEN_RMAT:
+            gen_rmat(e, nodes, (long)nodes * degree, &state);
+            break;
+        case GEN_BA:
+            gen_ba(e, nodes, degree, &state);
+            break;
+        case GEN_ER:
+            gen_er(e, nodes, (long)nodes * degree, &state);
+            break;
+        default:
+            error("[gen_graph] unknown model", HERE);
+    }
+
+    return e;
+}
+
+void gen_destroy(edge_buf *edges){
+    free(edges->vector);
+    free(edges);
+}
+
+void gen_write(FILE *stream, const edge_buf *edges, int nodes){
+    fprintf(stream, "%d %d %ld\n", nodes, nodes, edges->length / 2);
+    for(long i = 0; i<edges->length; i += 2)
+        fprintf(stream, "%d %d\n", edges->vector[i] + 1, edges->vector[i+1] + 1);
+}
+
+const char *gen_name(int model){
+    switch(model){
+        case GEN_RMAT:  return "rmat";
+        case GEN_BA:    return "ba";
+        case GEN_ER:    return "er";
+        default:        return "?";
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef LIBGEN
+#define LIBGEN
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "lib_graph.h"
+
+/**
+ * ### Synthetic graphs
+ * --------------------
+ * Directed random graphs for the benchmarks, as 0-based
+ * (origin, destination) pairs in an edge_buf. Same seed,
+ * same graph. Self loops and repeated edges are kept: the
+ * parser drops them like in any input file.
+ *
+ *  GEN_RMAT:   R-MAT (Chakrabarti et al.), `nodes * degree`
+ *              edges, quadrant probabilities RMAT_A/B/C and
+ *              1 - A - B - C, skewed in and out degrees
+ *  GEN_BA:     Barabasi-Albert preferential attachment, every
+ *              new node links to `degree` older nodes chosen
+ *              by degree (new -> old, like the test graphs)
+ *  GEN_ER:     Erdos-Renyi G(n, m), `nodes * degree` uniform
+ *              edges
+ */
+#define GEN_RMAT    0
+#define GEN_BA      1
+#define GEN_ER      2
+
+#ifndef RMAT_A
+#define RMAT_A 0.57
+#endif
+
+#ifndef RMAT_B
+#define RMAT_B 0.19
+#endif
+
+#ifndef RMAT_C
+#define RMAT_C 0.19
+#endif
+
+edge_buf *gen_graph(int model, int nodes, int degree, uint64_t seed);
+
+void gen_destroy(edge_buf *edges);
+
+/**
+ * gen_write()
+ * -----------
+ * writes the graph in the input format of graph_parse():
+ * "nodes nodes edges" then one 1-based "ori dest" per line
+ */
+void gen_write(FILE *stream, const edge_buf *edges, int nodes);
+
+const char *gen_name(int model);
+
+#endif
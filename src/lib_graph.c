@@ -1,16 +1,22 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <semaphore.h>
 #include <pthread.h>
 #include <stdbool.h>
-#define _GNU_SOURCE
+#include <string.h>
+#include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <math.h>
 
 #include "lib_graph.h"
 #include "lib_pagerank.h"
 #include "lib_supp.h"
+#include "lib_threads.h"
 
 /**
  * NOTES
@@ -23,108 +29,91 @@
  * - THREAD_TERM
  */
 
-graph *graph_alloc(int nodes, int edges){
+graph *graph_alloc(int nodes, long edges){
     graph *g = xmalloc(sizeof(graph),HERE);
-    g->nodes = nodes;
-    g->edges = edges;
-    g->out  = xcalloc(nodes,sizeof(int),    HERE);
-    g->in   = xcalloc(nodes,sizeof(inmap *),HERE);
+    g->nodes    = nodes;
+    g->edges    = edges;
+    g->out      = xcalloc(nodes,sizeof(int),    HERE);
+    g->offsets  = xcalloc(nodes + 1,sizeof(edge_t),HERE);
+    g->sources  = NULL;
+    g->map      = NULL;
+    g->map_size = 0;
+    g->packed   = NULL;
+    g->out_offsets  = NULL;
+    g->targets      = NULL;
     return g;
 }
 
 void graph_destroy(graph *g){
-    free(g->out);
-    for(int i = 0; i<g->nodes; i++)
-        inmap_free(g->in[i]);
-    
-    free(g->in);
+    if(g->packed != NULL){
+        free(g->packed->data);
+        free(g->packed->pos);
+        free(g->packed);
+    }
+
+    //never part of a snapshot
+    free(g->out_offsets);
+    free(g->targets);
+
+    if(g->map != NULL){
+        munmap(g->map, g->map_size);
+    }
+    else{
+        free(g->out);
+        free(g->offsets);
+        free(g->sources);
+    }
     free(g);
 }
 
 /**
- * inmap_push()
- * ------------
- * param 
- *      inmap **obj: pointer to inmap struct inside "in" vector
- *      int    elem: node to push in the array
- *      int   *size: pointer to int variable, useful to realloc the vector
+ * owner of the "in[dest]" list while building the lists:
+ * each thread writes only the lists it owns, so no lock
+ * is needed. Thread `j` owns the contiguous range
+ * [owner_start(j), owner_start(j+1))
  */
-inline void inmap_push(inmap **obj, int elem, int *size){
-    if(*obj == NULL){
-        *obj = xmalloc(sizeof(inmap), HERE);
-        *size = DYN_DEF;
-        (*obj)->vector = xmalloc(DYN_DEF * sizeof(int), HERE);
-        (*obj)->length = 0;
-    }
-    else if((*obj)->length == *size){
-        *size *= 2;
-        (*obj)->vector = xrealloc((*obj)->vector, (*size) * sizeof(int), HERE);
-    }
-
-    (*obj)->vector[(*obj)->length] = elem;
-    (*obj)->length += 1;
-
+static inline int list_owner(int dest, int nodes, int thread_count){
+    return (int)(((long)dest * thread_count) / nodes);
 }
 
-inline void inmap_free(inmap *ptr){
-    if(ptr == NULL)return;
+static inline int owner_start(int id, int nodes, int thread_count){
+    return (int)(((long)id * nodes + thread_count - 1) / thread_count);
+}
 
-    free(ptr->vector);
-    free(ptr);
+static inline void edge_buf_push(edge_buf *buf, int ori, int dest){
+    if(buf->length + 2 > buf->size){
+        buf->size = buf->size == 0 ? BUF_SIZE : buf->size * 2;
+        buf->vector = xrealloc(buf->vector, buf->size * sizeof(int), HERE);
+    }
+    buf->vector[buf->length]     = ori;
+    buf->vector[buf->length + 1] = dest;
+    buf->length += 2;
 }
 
 /**
- * ------------------------------------------
- * Parses a graph as a multithread solution
- * ------------------------------------------
- * parameters:
- *      `pathname` = file `.mtx`
- *      `int thread_count`
- * returns:
- *      `* struct graph`
- * -------------------------------------
- * ##### BRIEF NOTES ON .mtx files #####
- * -------------------------------------
- * - lines starting with '%' are comments 
- *   and are ignored
- * - first significant line has the following 
- *   syntax "a b c" where a,b,c are integers: 
- *   a must be equal to b (number of nodes)
- *   c is the number of edges
- * - subsequent lines contain two integers "a b": origin - destination
- *   edge definition
- * - IMPORTANT : any line formatted different 
- *   than the previous defs. is threaded as 
- *   malformed line and makes the parsing invalid
- *   terminating the entire process
- * -------------------------------------
- * ##### IMPLEMENTATION KEY POINTS #####
- * -------------------------------------
- * 1. Reads from file using threads to insert
- * nodes in the "in" arrays. Doesn't count
- * invalid edges (malformed). Treats "in" arrays
- * as "dynamic arrays" pushing each edge in the end
- * of the corrisponding array
- * 
- * 2. When the read is completed, uses threads to
- * sort "in" arrays concurrently updating lists
- * discarding duplicate edges in O(n) time. Then
- * reallocs the "in" arrays to a fixed size
- * 
- * 3. The duplicates are inserted in a buffer read
- * from the main thread that updates the count on
- * the "out" array
+ * graph_check_header()
+ * --------------------
+ * the "nodes nodes edges" line: nodes must fit an int and
+ * the edges the edge_t of this build
  */
-graph *graph_parse(const char *pathname, int thread_count,bool take_time){
-    
-    struct timeval start,end,alloc_start,alloc_end,file_start,file_end,sort_start,sort_end;
-    xgettimeofday(&start,take_time,HERE);
-    xgettimeofday(&alloc_start,take_time,HERE);
+static void graph_check_header(long r, long c, long edges_count){
+    if(r!=c || r < 1 || r > INT_MAX || edges_count<0){
+        error("[graph_parse] Bad file",HERE);
+    }
+
+    if(edges_count > (long)EDGE_MAX){
+        error("[graph_parse] more edges than a 32 bit offset can index: use pagerank64",HERE);
+    }
+}
+
+static graph *graph_read_stream(const char *pathname, thread_pool *pool, edge_buf **buckets, int *producers, struct timeval *alloc_end, bool take_time){
+
+    const int thread_count = pool->size;
 
     char    *getline_buff = NULL;
     size_t  getline_size = 0;
-    int     r,c,edges_count;
-    int     lines = 0;
+    long    r,c,edges_count;
+    long    lines = 0;
 
     FILE    *file = xfopen(pathname,"r",HERE);
 
@@ -135,23 +124,21 @@ graph *graph_parse(const char *pathname, int thread_count,bool take_time){
         lines ++;
     }while(getline_buff[0] == '%');
 
-    if(sscanf(getline_buff,"%d %d %d",&r,&c,&edges_count)!=3){
+    if(sscanf(getline_buff,"%ld %ld %ld",&r,&c,&edges_count)!=3){
         error("[sscanf] parsing first significant line",HERE);
     }
 
-    if(r!=c || r < 1 || edges_count<0){
-        error("[graph_parse] Bad file",HERE);
-    }
+    graph_check_header(r, c, edges_count);
 
-    graph   *g = graph_alloc(r,edges_count);
+    graph   *g = graph_alloc((int)r,edges_count);
 
     /**
      * Alloc and Init of structures needed by threads
+     * (one producer: the main thread)
      */
 
-    int *dynamic_size   = xmalloc(r * sizeof(int),HERE);
-
-    int interval_length = g->nodes / thread_count;
+    *producers  = 1;
+    *buckets    = xcalloc(thread_count, sizeof(edge_buf), HERE);
 
     int *pc_buffer[thread_count];
     int     pc_index[thread_count];
@@ -166,23 +153,20 @@ graph *graph_parse(const char *pathname, int thread_count,bool take_time){
         xsem_init(&(data_items_parser[i]),0,0,HERE);
     }
 
-    pthread_t   tid[thread_count];
     parser_attr arg[thread_count];  
 
     for(int i = 0; i<thread_count; i++){
         arg[i].id = i;
         arg[i].buffer = pc_buffer[i];
         arg[i].index = 0; 
-        arg[i].dyn_size = dynamic_size;
         arg[i].free_slots = &(free_slots_parser[i]);
         arg[i].data_items = &(data_items_parser[i]);
-        arg[i].in         = g->in;
+        arg[i].bucket     = &((*buckets)[i]);
 
-        xpthread_create(&tid[i],parser_routine,&arg[i],HERE);
+        pool_submit(pool,parser_routine,&arg[i]);
     }
 
-    xgettimeofday(&alloc_end,take_time,HERE);
-    xgettimeofday(&file_start,take_time,HERE);
+    xgettimeofday(alloc_end,take_time,HERE);
 
     int ori,dest;
     while(getline(&getline_buff,&getline_size,file) != -1){
@@ -190,7 +174,7 @@ graph *graph_parse(const char *pathname, int thread_count,bool take_time){
 
         if(sscanf(getline_buff,"%d %d",&ori,&dest)!=2){
             char *err_mess;
-            if(asprintf(&err_mess, "[sscanf] error parsing edge at line %d",lines)<0){
+            if(asprintf(&err_mess, "[sscanf] error parsing edge at line %ld",lines)<0){
                 error("[sscanf] error parsing edge",HERE);
             }
             error(err_mess,HERE);
@@ -204,12 +188,11 @@ graph *graph_parse(const char *pathname, int thread_count,bool take_time){
 
         //insert edge on pc_buffer of one thread
         /**
-         * to insert the edge, the in[dest] must be locked
-         * so i insert the edge in just one buffer, selection
-         * the index using the modulo operator
+         * the edge goes to the thread that owns in[dest],
+         * so the lists can be built without locks
          */
 
-        int j = ((dest-1) / interval_length) % thread_count;
+        int j = list_owner(dest-1, g->nodes, thread_count);
 
         //printf("ori %d dest %d\n",ori-1,dest-1);
 
@@ -222,8 +205,6 @@ graph *graph_parse(const char *pathname, int thread_count,bool take_time){
 
     }
 
-    xgettimeofday(&file_end,take_time,HERE);
-
     //insert termination value for threads
     for(int i = 0; i<thread_count; i++){
         xsem_wait(&(free_slots_parser[i]),HERE);
@@ -233,13 +214,10 @@ graph *graph_parse(const char *pathname, int thread_count,bool take_time){
         xsem_post(&(data_items_parser[i]),HERE); 
     }
 
-    for(int i = 0; i<thread_count; i++){
-        xpthread_join(tid[i],NULL,HERE);
-    }
+    pool_wait(pool);
 
     //deallocs struct needed no more
     xfclose(file,HERE);
-    free(dynamic_size);
     free(getline_buff);
 
     for(int i = 0; i<thread_count; i++){
@@ -247,94 +225,463 @@ graph *graph_parse(const char *pathname, int thread_count,bool take_time){
         xsem_destroy(&(free_slots_parser[i]),HERE);
         xsem_destroy(&(data_items_parser[i]),HERE);
     }
+
+    return g;
+}
     
-    int *sorter_buffer = xmalloc(BUF_SIZE * sizeof(int),HERE);
-    sem_t free_slots_sorter,data_items_sorter;
-    pthread_mutex_t buffer_mux;
-    xsem_init(&free_slots_sorter,0,BUF_SIZE,HERE);
-    xsem_init(&data_items_sorter,0,0,HERE);
-    xpthread_mutex_init(&buffer_mux,HERE);
-    
+
+/**
+ * scan_int()
+ * ----------
+ * hand written replacement of sscanf("%d") over a non
+ * NUL-terminated range [p,end): skips blanks, reads an
+ * optional sign and the digits. Values out of the int
+ * range saturate (they are discarded as invalid edges)
+ * returns
+ *      pointer to the first char after the number
+ *      NULL if no number was found
+ */
+static inline const char *scan_int(const char *p, const char *end, int *val){
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f'))
+        p++;
+
+    bool neg = false;
+    if(p < end && (*p == '-' || *p == '+')){
+        neg = (*p == '-');
+        p++;
+    }
+
+    if(p == end || *p < '0' || *p > '9')
+        return NULL;
+
+    long v = 0;
+    while(p < end && *p >= '0' && *p <= '9'){
+        if(v <= INT_MAX)
+            v = v * 10 + (*p - '0');
+        p++;
+    }
+    if(v > INT_MAX)
+        v = INT_MAX;
+
+    *val = neg ? -(int)v : (int)v;
+    return p;
+}
+
+/**
+ * scan_long()
+ * -----------
+ * scan_int() for the header counts (no sign, saturates at
+ * LONG_MAX)
+ */
+static const char *scan_long(const char *p, const char *end, long *val){
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f'))
+        p++;
+
+    if(p == end || *p < '0' || *p > '9')
+        return NULL;
+
+    long v = 0;
+    while(p < end && *p >= '0' && *p <= '9'){
+        v = (v <= (LONG_MAX - 9) / 10) ? v * 10 + (*p - '0') : LONG_MAX;
+        p++;
+    }
+
+    *val = v;
+    return p;
+}
+
+/**
+ * chunk_parser_routine()
+ * ----------------------
+ * tokenizes the lines in [chunk_start,chunk_end) of the
+ * mapped file. Valid edges are inserted in the bucket of
+ * the thread that owns in[dest]; the first malformed line
+ * stops the scan and its local number is stored in
+ * `bad_line` (global number is computed by the main thread)
+ */
+void *chunk_parser_routine(void *attr){
+    chunk_attr *arg = (chunk_attr *)attr;
+    const char *p   = arg->chunk_start;
+    const char *end = arg->chunk_end;
+    const int nodes = arg->nodes;
+    int ori,dest;
+
+    while(p < end){
+        const char *eol = memchr(p, '\n', end - p);
+        if(eol == NULL)
+            eol = end;
+
+        arg->lines += 1;
+
+        const char *q = scan_int(p, eol, &ori);
+        if(q != NULL)
+            q = scan_int(q, eol, &dest);
+        if(q == NULL){
+            arg->bad_line = arg->lines;
+            break;
+        }
+
+        p = eol + 1;
+
+        //discard not valid edges
+        if( ori == dest || ori<=0 || dest <=0 || ori>nodes || dest>nodes){
+            arg->discarded += 1;
+            continue;
+        }
+
+        edge_buf_push(&(arg->buckets[list_owner(dest-1, nodes, arg->thread_count)]), ori-1, dest-1);
+        __atomic_fetch_add(&(arg->out[ori-1]), 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+/**
+ * graph_read_mmap()
+ * -----------------
+ * maps the file in memory, parses comments and header on
+ * the main thread and splits the remaining bytes in
+ * `thread_count` ranges aligned on newline boundaries.
+ * Each thread tokenizes its own range (no shared buffer)
+ * and fills one row of the `buckets` matrix.
+ * returns NULL if the file can't be mapped (not a regular
+ * file), so the caller can fall back to the stream reader
+ */
+static graph *graph_read_mmap(const char *pathname, thread_pool *pool, edge_buf **buckets, int *producers, struct timeval *alloc_end, bool take_time){
+
+    const int thread_count = pool->size;
+
+    int fd = open(pathname, O_RDONLY);
+    if(fd < 0)
+        error("[open] input file",HERE);
+
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+        error("[fstat] input file",HERE);
+
+    if(!S_ISREG(st.st_mode) || st.st_size == 0){
+        xclose(fd,HERE);
+        return NULL;
+    }
+
+    const size_t size = (size_t)st.st_size;
+    char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED)
+        error("[mmap] input file",HERE);
+    madvise(map, size, MADV_SEQUENTIAL);
+    xclose(fd,HERE);
+
+    const char *p   = map;
+    const char *end = map + size;
+    const char *eol;
+    long lines = 0;
+    long r = 0, c = 0, edges_count = 0;
+
+    //skip comments
+    do{
+        if(p >= end)
+            error("[graph_parse] comments",HERE);
+        eol = memchr(p, '\n', end - p);
+        if(eol == NULL)
+            eol = end;
+        lines ++;
+        if(*p != '%')
+            break;
+        p = eol + 1;
+    }while(true);
+
+    const char *q = scan_long(p, eol, &r);
+    if(q != NULL) q = scan_long(q, eol, &c);
+    if(q != NULL) q = scan_long(q, eol, &edges_count);
+    if(q == NULL){
+        error("[graph_parse] parsing first significant line",HERE);
+    }
+
+    graph_check_header(r, c, edges_count);
+
+    graph   *g = graph_alloc((int)r,edges_count);
+
+    *producers  = thread_count;
+    *buckets    = xcalloc(thread_count * thread_count, sizeof(edge_buf), HERE);
+
+    /**
+     * split the body in ranges of (about) the same
+     * length, moving each boundary after a newline
+     */
+    const char *body = (eol < end) ? eol + 1 : end;
+    const char *bound[thread_count + 1];
+    bound[0]            = body;
+    bound[thread_count] = end;
+    for(int i = 1; i<thread_count; i++){
+        const char *b = body + ((end - body) / thread_count) * i;
+        if(b < bound[i-1])
+            b = bound[i-1];
+        if(b > body && b < end && b[-1] != '\n'){
+            b = memchr(b, '\n', end - b);
+            b = (b == NULL) ? end : b + 1;
+        }
+        bound[i] = b;
+    }
+
+    chunk_attr  arg[thread_count];
+
+    for(int i = 0; i<thread_count; i++){
+        arg[i].id           = i;
+        arg[i].thread_count = thread_count;
+        arg[i].nodes        = (int)r;
+        arg[i].chunk_start  = bound[i];
+        arg[i].chunk_end    = bound[i+1];
+        arg[i].lines        = 0;
+        arg[i].bad_line     = 0;
+        arg[i].discarded    = 0;
+        arg[i].buckets      = *buckets + i * thread_count;
+        arg[i].out          = g->out;
+    }
+
+    xgettimeofday(alloc_end,take_time,HERE);
+
+    for(int i = 0; i<thread_count; i++)
+        pool_submit(pool,chunk_parser_routine,&arg[i]);
+    pool_wait(pool);
+
+    //report the first malformed line (in file order)
+    for(int i = 0; i<thread_count; i++){
+        if(arg[i].bad_line != 0){
+            char *err_mess;
+            if(asprintf(&err_mess, "[graph_parse] error parsing edge at line %ld",lines + arg[i].bad_line)<0){
+                error("[graph_parse] error parsing edge",HERE);
+            }
+            error(err_mess,HERE);
+        }
+        lines       += arg[i].lines;
+        g->edges    -= arg[i].discarded;
+    }
+
+    munmap(map, size);
+
+    return g;
+}
+
+/**
+ * ------------------------------------------
+ * Parses a graph as a multithread solution
+ * ------------------------------------------
+ * parameters:
+ *      `pathname` = file `.mtx`
+ *      `thread_pool *pool` = workers of every phase
+ *      `int flags` = read mode | sort mode
+ * returns:
+ *      `* struct graph`
+ * -------------------------------------
+ * ##### BRIEF NOTES ON .mtx files #####
+ * -------------------------------------
+ * - lines starting with '%' are comments 
+ *   and are ignored
+ * - first significant line has the following 
+ *   syntax "a b c" where a,b,c are integers: 
+ *   a must be equal to b (number of nodes)
+ *   c is the number of edges
+ * - subsequent lines contain two integers "a b": origin - destination
+ *   edge definition
+ * - IMPORTANT : any line formatted different 
+ *   than the previous defs. is threaded as 
+ *   malformed line and makes the parsing invalid
+ *   terminating the entire process
+ * -------------------------------------
+ * ##### IMPLEMENTATION KEY POINTS #####
+ * -------------------------------------
+ * 1. Reads from file using threads, collecting the
+ * edges in buckets (one for each thread owning a
+ * range of destinations). Doesn't count invalid
+ * edges (malformed)
+ * 
+ * 2. Builds the CSR "in" arrays with a count then
+ * scatter pass over the buckets (see csr_*_routine)
+ * 
+ * 3. When the build is completed, uses threads to
+ * sort "in" arrays concurrently updating lists
+ * discarding duplicate edges in O(n) time. Then
+ * compacts the CSR if duplicates were found
+ * 
+ * 4. Each sorter thread counts the duplicates in
+ * its own correction array, the corrections are
+ * merged on the "out" array in parallel (each
+ * thread on its own node range)
+ * -------------------------------------
+ * ##### READ MODES #####
+ * -------------------------------------
+ * - PARSE_STREAM: main thread reads lines with getline
+ *   and sends edges to `parser_routine` threads through
+ *   semaphore-guarded buffers
+ * - PARSE_MMAP: the file is mapped in memory and split in
+ *   ranges at newline boundaries, each thread tokenizes
+ *   its own range (see graph_read_mmap). Falls back to
+ *   PARSE_STREAM if the input is not a regular file
+ * - if `pathname` is a binary snapshot (graph_snapshot_save)
+ *   it is mapped with graph_snapshot_load, no parsing at all
+ */
+graph *graph_parse(const char *pathname, thread_pool *pool, int flags, bool take_time){
+
+    const int thread_count = pool->size;
+
+    struct timeval start,end,alloc_start,alloc_end,file_end,build_end,sort_start,sort_end;
+    xgettimeofday(&start,take_time,HERE);
+
+    if(graph_is_snapshot(pathname)){
+        graph *g = graph_snapshot_load(pathname);
+        xgettimeofday(&end,take_time,HERE);
+        if(take_time){
+            fprintf(stderr,"\n======\tTime Stats\t======\n");
+            fprintf(stderr,"load time\t\t%.6f sec\n",exctract_time(start,end,take_time));
+            fprintf(stderr,"\n=========================\n");
+        }
+        return g;
+    }
+
+    xgettimeofday(&alloc_start,take_time,HERE);
+
+    edge_buf    *buckets = NULL;
+    int         producers;
+
+    graph *g = NULL;
+    if(flags & PARSE_MMAP)
+        g = graph_read_mmap(pathname, pool, &buckets, &producers, &alloc_end, take_time);
+    if(g == NULL)
+        g = graph_read_stream(pathname, pool, &buckets, &producers, &alloc_end, take_time);
+
+    xgettimeofday(&file_end,take_time,HERE);
+
+    csr_attr    csr_arg[thread_count];
+    edge_t      *degree = xmalloc(g->nodes * sizeof(edge_t),HERE);
+
+    /**
+     * Build of the CSR in-adjacency (count then scatter)
+     * 1. each thread counts the in-degree of the nodes it
+     *    owns and computes a local prefix sum
+     * 2. main thread computes the base offset of each range
+     * 3. each thread scatters its edges in `sources`
+     */
+    for(int i = 0; i<thread_count; i++){
+        csr_arg[i].id           = i;
+        csr_arg[i].thread_count = thread_count;
+        csr_arg[i].producers    = producers;
+        csr_arg[i].range_start  = owner_start(i,   g->nodes, thread_count);
+        csr_arg[i].range_end    = owner_start(i+1, g->nodes, thread_count);
+        csr_arg[i].buckets      = buckets;
+        csr_arg[i].cursor       = degree;
+        csr_arg[i].graph        = g;
+        pool_submit(pool,csr_count_routine,&(csr_arg[i]));
+    }
+    pool_wait(pool);
+
+    long base = 0;
+    for(int i = 0; i<thread_count; i++){
+        csr_arg[i].base = base;
+        base += csr_arg[i].total;
+    }
+
+    //the header may undercount the edges
+    if(base > (long)EDGE_MAX)
+        error("[graph_parse] more edges than a 32 bit offset can index: use pagerank64",HERE);
+
+    g->edges    = base;
+    g->sources  = xmalloc((base > 0 ? base : 1) * sizeof(int),HERE);
+
+    for(int i = 0; i<thread_count; i++)
+        pool_submit(pool,csr_scatter_routine,&(csr_arg[i]));
+    pool_wait(pool);
+
+    free(buckets);
+    xgettimeofday(&build_end,take_time,HERE);
+
     /**
      * Create a new group of threads which sorts all "in[i]" in their
-     * interval inserting duplicates in a pc_buffer that main
-     * thread reads to decrement "out[i]"
+     * interval. Each thread counts the duplicates it finds in its own
+     * correction array (no shared buffer, no lock): correction[t][i]
+     * is the number of duplicate edges i->x removed by thread t
      */
 
+    int *correction[thread_count];
+    for(int i = 0; i<thread_count; i++)
+        correction[i] = NULL;
+
     //struct shared between threads
     sorter_attr_shared sorter_shared;
-    sorter_shared.pc_index    = 0;
-    sorter_shared.pc_buffer   = sorter_buffer;
-    sorter_shared.graph       = g;
-    sorter_shared.buffer_mux  = &buffer_mux;
-    sorter_shared.free_slots  = &free_slots_sorter;
-    sorter_shared.data_items  = &data_items_sorter;
-
-    //calculate interval length
-    /**
-     * DEBUG: Add error support
-     * When 0 lists are assigned to a thread 
-     */
-    
-    int int_start   = 0;
-    const int int_length  = (int)(g->nodes / thread_count);
+    sorter_shared.graph         = g;
+    sorter_shared.degree        = degree;
+    sorter_shared.correction    = correction;
+    sorter_shared.thread_count  = thread_count;
+    sorter_shared.sort_mode     = flags & SORT_RADIX;
+
+    //same ranges of the CSR build
     sorter_attr thread_attr[thread_count];
     for(int i = 0; i<thread_count; i++){
-        thread_attr[i].interval_start   = int_start;
-        thread_attr[i].interval_end     = i == thread_count - 1? g->nodes -1 : int_start + int_length;
+        thread_attr[i].id               = i;
+        thread_attr[i].interval_start   = csr_arg[i].range_start;
+        thread_attr[i].interval_end     = csr_arg[i].range_end - 1;
         thread_attr[i].shared           = &sorter_shared;
-        xpthread_create(&tid[i],sorter_routine,&(thread_attr[i]),HERE);
-
-        int_start += int_length +1;
-        
     }
+
     xgettimeofday(&sort_start,take_time,HERE);
-    //puts("SORTER STARTED");
 
-    //read from buffer
-    int ready_for_join = 0;
-    int index = 0;
-    int duplicate;
+    for(int i = 0; i<thread_count; i++)
+        pool_submit(pool,sorter_routine,&(thread_attr[i]));
+    pool_wait(pool);
 
-    do{
-        xsem_wait(&data_items_sorter,HERE);
-            duplicate = sorter_buffer[index];
-            index = index + 1 % BUF_SIZE;
-        xsem_post(&free_slots_sorter,HERE);
+    /**
+     * Merge of the corrections on "out" and count of the
+     * dead-end nodes (parallel for over the nodes)
+     */
+    sorter_shared.dead_count = 0;
+    pool_parallel_for(pool, 0, g->nodes, MERGE_CHUNK, dedup_merge_body, &sorter_shared);
 
-        if(duplicate == THREAD_TERM){
-            ready_for_join++;
-        }
-        else{
-            g->out[duplicate]   -= 1;
-            g->edges            -= 1;
+    const long all_edges = g->edges;
+    g->edges = 0;
+    for(int i = 0; i<thread_count; i++){
+        g->edges    += thread_attr[i].kept;
+        free(correction[i]);
+    }
+    g->dead_count = sorter_shared.dead_count;
+
+    /**
+     * Duplicates leave holes at the end of the lists:
+     * compact the CSR in new arrays (ranges are already
+     * known, so each thread copies its own lists)
+     */
+    if(g->edges != all_edges){
+        edge_t *offsets = xmalloc((g->nodes + 1) * sizeof(edge_t),HERE);
+        int *sources = xmalloc((g->edges > 0 ? g->edges : 1) * sizeof(int),HERE);
+        offsets[0] = 0;
+
+        base = 0;
+        for(int i = 0; i<thread_count; i++){
+            csr_arg[i].base         = base;
+            csr_arg[i].new_offsets  = offsets;
+            csr_arg[i].new_sources  = sources;
+            base += thread_attr[i].kept;
         }
 
-    }while(ready_for_join < thread_count);
+        for(int i = 0; i<thread_count; i++)
+            pool_submit(pool,csr_compact_routine,&(csr_arg[i]));
+        pool_wait(pool);
 
-    for(int i = 0; i<thread_count; i++){
-        xpthread_join(tid[i],NULL,HERE);
+        free(g->offsets);
+        free(g->sources);
+        g->offsets = offsets;
+        g->sources = sources;
     }
 
     xgettimeofday(&sort_end,take_time,HERE);
 
-    int dead_count = 0;
-    for(int i = 0; i<g->nodes; i++){
-        if(g->out[i] == 0) dead_count++;
-    }
-    g->dead_count = dead_count;
-
-    free(sorter_buffer);
-    xsem_destroy(&free_slots_sorter,HERE);
-    xsem_destroy(&data_items_sorter,HERE);
-    xpthread_mutex_destroy(&buffer_mux,HERE);
+    free(degree);
 
     xgettimeofday(&end,take_time,HERE);
 
     if(take_time){
         fprintf(stderr,"\n======\tTime Stats\t======\n");
         fprintf(stderr,"alloc time\t\t%.6f sec\n",exctract_time(alloc_start,alloc_end,take_time));
-        fprintf(stderr,"read time\t\t%.6f sec\n",exctract_time(file_start,file_end,take_time));
+        fprintf(stderr,"read time\t\t%.6f sec\n",exctract_time(alloc_end,file_end,take_time));
+        fprintf(stderr,"build time\t\t%.6f sec\n",exctract_time(file_end,build_end,take_time));
         fprintf(stderr,"sort time\t\t%.6f sec\n",exctract_time(sort_start,sort_end,take_time));
         fprintf(stderr,"total time\t\t%.6f sec\n",exctract_time(start,end,take_time));
         fprintf(stderr,"\n=========================\n");
@@ -358,74 +705,759 @@ void *parser_routine(void *attr){
         xsem_post(arg->free_slots,HERE);
 
         if(ori == THREAD_TERM || dest == THREAD_TERM){
-            pthread_exit(NULL);
+            return NULL;
         }
         
-        inmap_push(&(((arg)->in)[dest]), ori, &((arg->dyn_size)[dest]));
+        edge_buf_push(arg->bucket, ori, dest);
+
+    }
+}
+
+/**
+ * csr_count_routine()
+ * -------------------
+ * counts in offsets[dest+1] the in-degree of each node in
+ * [range_start,range_end), then turns the counts in a
+ * local (inclusive) prefix sum. `total` is the number of
+ * edges that land in the range
+ */
+void *csr_count_routine(void *attr){
+    csr_attr *arg   = (csr_attr *)attr;
+    edge_t *offsets = arg->graph->offsets;
+
+    for(int p = 0; p<arg->producers; p++){
+        edge_buf *buf = &(arg->buckets[p * arg->thread_count + arg->id]);
+        for(long i = 0; i<buf->length; i+=2)
+            offsets[buf->vector[i+1] + 1] += 1;
+    }
+
+    long running = 0;
+    for(int i = arg->range_start + 1; i<=arg->range_end; i++){
+        running     += offsets[i];
+        offsets[i]   = running;
+    }
+    arg->total = running;
+
+    return NULL;
+}
+
+/**
+ * csr_scatter_routine()
+ * ---------------------
+ * moves the local prefix sum by `base` and writes every
+ * edge of the range in its slot of `sources`
+ * (`cursor` keeps the next free slot of each list)
+ */
+void *csr_scatter_routine(void *attr){
+    csr_attr *arg   = (csr_attr *)attr;
+    edge_t *offsets = arg->graph->offsets;
+    int *sources    = arg->graph->sources;
+    edge_t *cursor  = arg->cursor;
+
+    if(arg->range_start < arg->range_end)
+        cursor[arg->range_start] = arg->base;
+    for(int i = arg->range_start + 1; i<=arg->range_end; i++){
+        offsets[i] += arg->base;
+        if(i < arg->range_end)
+            cursor[i] = offsets[i];
+    }
 
+    for(int p = 0; p<arg->producers; p++){
+        edge_buf *buf = &(arg->buckets[p * arg->thread_count + arg->id]);
+        for(long i = 0; i<buf->length; i+=2)
+            sources[cursor[buf->vector[i+1]]++] = buf->vector[i];
+        free(buf->vector);
+        buf->vector = NULL;
     }
+
+    return NULL;
 }
 
+/**
+ * csr_compact_routine()
+ * ---------------------
+ * copies the deduplicated lists of the range (length in
+ * `cursor`) in the new arrays, starting from `base`
+ */
+void *csr_compact_routine(void *attr){
+    csr_attr *arg   = (csr_attr *)attr;
+    graph *g        = arg->graph;
+    long pos        = arg->base;
+
+    for(int i = arg->range_start; i<arg->range_end; i++){
+        memcpy(arg->new_sources + pos, g->sources + g->offsets[i], arg->cursor[i] * sizeof(int));
+        pos += arg->cursor[i];
+        arg->new_offsets[i+1] = pos;
+    }
+
+    return NULL;
+}
 
 int cmp(const void *a, const void *b){
-    return (*(int *)a - *(int *)b);
+    const int x = *(const int *)a;
+    const int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+inline void insertion_sort(int *arr, int length){
+    for(int i = 1; i<length; i++){
+        int elem = arr[i];
+        int j = i - 1;
+        while(j >= 0 && arr[j] > elem){
+            arr[j+1] = arr[j];
+            j--;
+        }
+        arr[j+1] = elem;
+    }
+}
+
+/**
+ * radix_sort()
+ * ------------
+ * LSD radix sort on 8 bit digits of non negative ints.
+ * Only the digits needed to represent `max_value` are
+ * sorted (2 passes for graphs up to 65536 nodes).
+ * `tmp` must hold `length` ints. The result is always
+ * left in `arr`
+ */
+void radix_sort(int *arr, int *tmp, long length, int max_value){
+    int passes = 0;
+    for(unsigned v = (unsigned)max_value; v > 0; v >>= 8)
+        passes++;
+
+    int *src = arr, *dst = tmp, *swap;
+    long count[256];
+
+    for(int pass = 0; pass<passes; pass++){
+        const int shift = pass * 8;
+        memset(count, 0, sizeof(count));
+
+        for(long i = 0; i<length; i++)
+            count[((unsigned)src[i] >> shift) & 0xFF]++;
+
+        //skip the pass if all elements share the digit
+        if(count[((unsigned)src[0] >> shift) & 0xFF] == length)
+            continue;
+
+        long sum = 0;
+        for(int d = 0; d<256; d++){
+            long c      = count[d];
+            count[d]    = sum;
+            sum        += c;
+        }
+
+        for(long i = 0; i<length; i++)
+            dst[count[((unsigned)src[i] >> shift) & 0xFF]++] = src[i];
+
+        swap = src; src = dst; dst = swap;
+    }
+
+    if(src != arr)
+        memcpy(arr, src, length * sizeof(int));
 }
 
 void *sorter_routine(void *attr){
     sorter_attr *arg = (sorter_attr *)attr;
     sorter_attr_shared *shared = arg->shared;
+    graph *g = shared->graph;
 
-    inmap *curr_obj;
     int *arr;
-    int k;
+    edge_t k,length;
+    int *tmp        = NULL;     //radix sort scratch buffer
+    edge_t tmp_size = 0;
+    arg->kept = 0;
     //select vector in its interval 
     for(int j = arg->interval_start; j<=arg->interval_end; j++){
-        curr_obj = shared->graph->in[j];
+        arr     = g->sources + g->offsets[j];
+        length  = g->offsets[j+1] - g->offsets[j];
 
         //no vector to sort
-        if(curr_obj == NULL){
+        if(length == 0){
+            shared->degree[j] = 0;
             continue;
         }
 
-        qsort(curr_obj->vector,curr_obj->length,sizeof(int),cmp);
+        if(shared->sort_mode == SORT_QSORT){
+            qsort(arr,length,sizeof(int),cmp);
+        }
+        else if(length <= SORT_SMALL){
+            insertion_sort(arr,(int)length);
+        }
+        else{
+            if(length > tmp_size){
+                tmp_size    = length;
+                tmp         = xrealloc(tmp, tmp_size * sizeof(int), HERE);
+            }
+            radix_sort(arr,tmp,length,g->nodes - 1);
+        }
 
         //start "deleting" duplicates
         k = 1;
 
-        arr = curr_obj->vector;
-
-        for(int i = 1; i<curr_obj->length; i++){
+        for(edge_t i = 1; i<length; i++){
             //shift left no duplicate elements
             if(arr[i] != arr[i-1]){
                 arr[k] = arr[i];
                 k+=1;
             }
-            //insert duplicates on buffer
+            //count duplicates in the thread correction array
             else{
-                xsem_wait(shared->free_slots,HERE);
-                    xpthread_mutex_lock(shared->buffer_mux,HERE);
+                /**
+                 * allocated at the first duplicate: calloc of
+                 * large blocks maps zero pages, so only the pages
+                 * actually touched are backed by memory
+                 */
+                if(shared->correction[arg->id] == NULL)
+                    shared->correction[arg->id] = xcalloc(g->nodes,sizeof(int),HERE);
+                shared->correction[arg->id][arr[i]] += 1;
+            }
+        }
+
+        //new length (lists are compacted after the join)
+        shared->degree[j] = k;
+        arg->kept += k;
+    }
+
+    free(tmp);
+    return NULL;
+}
+
+/**
+ * dedup_merge_body()
+ * ------------------
+ * subtracts from out[i] the duplicates counted by every
+ * sorter thread, for i in [start,end), and adds the
+ * dead-end nodes of the chunk to the shared count
+ */
+void dedup_merge_body(void *attr, int start, int end){
+    sorter_attr_shared *shared = (sorter_attr_shared *)attr;
+    int *out = shared->graph->out;
+
+    for(int t = 0; t<shared->thread_count; t++){
+        const int *corr = shared->correction[t];
+        if(corr == NULL)
+            continue;
+        for(int i = start; i<end; i++)
+            out[i] -= corr[i];
+    }
+
+    int dead_count = 0;
+    for(int i = start; i<end; i++){
+        if(out[i] == 0)
+            dead_count += 1;
+    }
+    __atomic_fetch_add(&(shared->dead_count), dead_count, __ATOMIC_RELAXED);
+}
+
+/**
+ * graph_partition()
+ * -----------------
+ * splits the nodes in `parts` contiguous ranges of about the
+ * same work, [bounds[p], bounds[p+1]). The work of node v is
+ * its in-degree + 1 (the gather plus the per node update):
+ * offsets[] is already the prefix sum of the in-degrees, so
+ * each bound is a binary search on offsets[v] + v
+ */
+void graph_partition(graph *g, int parts, int *bounds){
+    const long total = (long)g->edges + g->nodes;
+
+    bounds[0]       = 0;
+    bounds[parts]   = g->nodes;
+
+    for(int p = 1; p<parts; p++){
+        const long target = (total * p) / parts;
+        int lo = bounds[p-1];
+        int hi = g->nodes;
+
+        //smallest v with offsets[v] + v >= target
+        while(lo < hi){
+            int mid = lo + (hi - lo) / 2;
+            if((long)g->offsets[mid] + mid < target)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        bounds[p] = lo;
+    }
+}
+
+/**
+ * out_bucket_routine()
+ * --------------------
+ * producer side of the transpose: every in-edge u -> v of
+ * the thread destination range goes as the pair (v, u) in
+ * the bucket of the owner of u, scanning v in order
+ */
+static void *out_bucket_routine(void *attr){
+    csr_attr *arg       = (csr_attr *)attr;
+    const graph *g      = arg->graph;
+    edge_buf *buckets   = &(arg->buckets[arg->id * arg->thread_count]);
+
+    for(int v = arg->range_start; v<arg->range_end; v++)
+        for(edge_t j = g->offsets[v]; j<g->offsets[v+1]; j++)
+            edge_buf_push(&(buckets[list_owner(g->sources[j], g->nodes, arg->thread_count)]), v, g->sources[j]);
+
+    return NULL;
+}
+
+/**
+ * the transpose is built as the CSR of graph_parse(): the
+ * buckets are filled by destination ranges, in order, then
+ * csr_count_routine() and csr_scatter_routine() build the
+ * in-lists of a graph whose in-lists are the out-lists of g.
+ * The scatter reads the buckets of range 0 first, so every
+ * list comes out sorted without a sort pass
+ */
+void graph_build_out(graph *g, thread_pool *pool){
+    if(g->targets != NULL)
+        return;
+    if(g->sources == NULL)
+        error("[graph_build_out] in-lists already compressed",HERE);
+
+    const int thread_count  = pool->size;
+    int         bounds[thread_count + 1];
+    csr_attr    csr_arg[thread_count];
+    edge_buf    *buckets    = xcalloc((size_t)thread_count * thread_count, sizeof(edge_buf), HERE);
+    edge_t      *cursor     = xmalloc(g->nodes * sizeof(edge_t), HERE);
+
+    graph out   = {.nodes = g->nodes};
+    out.offsets = xcalloc(g->nodes + 1, sizeof(edge_t), HERE);
+    out.sources = xmalloc((g->edges + 1) * sizeof(int), HERE);
+
+    graph_partition(g, thread_count, bounds);
+    for(int i = 0; i<thread_count; i++){
+        csr_arg[i].id           = i;
+        csr_arg[i].thread_count = thread_count;
+        csr_arg[i].producers    = thread_count;
+        csr_arg[i].range_start  = bounds[i];
+        csr_arg[i].range_end    = bounds[i+1];
+        csr_arg[i].buckets      = buckets;
+        csr_arg[i].cursor       = cursor;
+        csr_arg[i].graph        = g;
+        pool_submit(pool,out_bucket_routine,&(csr_arg[i]));
+    }
+    pool_wait(pool);
+
+    //from here on each thread owns a range of sources
+    for(int i = 0; i<thread_count; i++){
+        csr_arg[i].range_start  = owner_start(i,   g->nodes, thread_count);
+        csr_arg[i].range_end    = owner_start(i+1, g->nodes, thread_count);
+        csr_arg[i].graph        = &out;
+        pool_submit(pool,csr_count_routine,&(csr_arg[i]));
+    }
+    pool_wait(pool);
+
+    long base = 0;
+    for(int i = 0; i<thread_count; i++){
+        csr_arg[i].base = base;
+        base += csr_arg[i].total;
+    }
+
+    for(int i = 0; i<thread_count; i++)
+        pool_submit(pool,csr_scatter_routine,&(csr_arg[i]));
+    pool_wait(pool);
+
+    free(buckets);
+    free(cursor);
+
+    g->out_offsets  = out.offsets;
+    g->targets      = out.sources;
+}
 
-                        shared->pc_buffer[shared->pc_index] = arr[i];
-                        shared->pc_index = (shared->pc_index + 1) % BUF_SIZE;
+/**
+ * packed_size_body() / packed_encode_body()
+ * -----------------------------------------
+ * parallel for bodies of graph_compress(): bytes of every
+ * list of [start, end) in start_of[i+1], then (after the
+ * prefix sum) the encoding of each list at start_of[i]
+ */
+typedef struct packed_attr{
+    graph   *g;
+    size_t  *start_of;      //nodes + 1 entries
+}packed_attr;
+
+static inline int packed_bytes(uint32_t v){
+    return (v < (1u << 8)) ? 1 : (v < (1u << 16)) ? 2 : (v < (1u << 24)) ? 3 : 4;
+}
+
+static void packed_size_body(void *attr, int start, int end){
+    packed_attr *arg = (packed_attr *)attr;
+    const graph *g = arg->g;
+
+    for(int i = start; i<end; i++){
+        const edge_t first  = g->offsets[i];
+        const edge_t length = g->offsets[i+1] - first;
+        size_t bytes        = (length + 3) / 4;     //tags
+        int prev            = 0;
+
+        for(edge_t j = 0; j<length; j++){
+            bytes  += packed_bytes((uint32_t)(g->sources[first + j] - prev));
+            prev    = g->sources[first + j];
+        }
+        arg->start_of[i+1] = bytes;
+    }
+}
+
+static void packed_encode_body(void *attr, int start, int end){
+    packed_attr *arg = (packed_attr *)attr;
+    const graph *g = arg->g;
+
+    for(int i = start; i<end; i++){
+        const edge_t first  = g->offsets[i];
+        const edge_t length = g->offsets[i+1] - first;
+        uint8_t *p          = g->packed->data + arg->start_of[i];
+        int prev            = 0;
+
+        for(edge_t j = 0; j<length; j += 4){
+            uint8_t *tag    = p++;
+            const int group = (length - j < 4) ? (int)(length - j) : 4;
+
+            *tag = 0;
+            for(int k = 0; k<group; k++){
+                const uint32_t gap  = (uint32_t)(g->sources[first + j + k] - prev);
+                const int bytes     = packed_bytes(gap);
+
+                prev  = g->sources[first + j + k];
+                *tag |= (uint8_t)((bytes - 1) << (2 * k));
+                for(int b = 0; b<bytes; b++)
+                    *p++ = (uint8_t)(gap >> (8 * b));
+            }
+        }
+    }
+}
+
+void graph_compress(graph *g, thread_pool *pool, bool take_time){
+    struct timeval start, end;
+    xgettimeofday(&start, take_time, HERE);
+
+    packed_adj *packed  = xmalloc(sizeof(packed_adj), HERE);
+    packed_attr arg;
+
+    arg.g           = g;
+    arg.start_of    = xmalloc((g->nodes + 1) * sizeof(size_t), HERE);
+    arg.start_of[0] = 0;
+    g->packed       = packed;
+
+    pool_parallel_for(pool, 0, g->nodes, MERGE_CHUNK, packed_size_body, &arg);
+    for(int i = 0; i<g->nodes; i++)
+        arg.start_of[i+1] += arg.start_of[i];
+
+    packed->bytes   = arg.start_of[g->nodes];
+    packed->data    = xcalloc(packed->bytes + PACKED_PAD, 1, HERE);
+
+    pool_parallel_for(pool, 0, g->nodes, MERGE_CHUNK, packed_encode_body, &arg);
+
+    const int strides = g->nodes / PACKED_STRIDE + 1;
+    packed->pos = xmalloc(strides * sizeof(size_t), HERE);
+    for(int k = 0; k<strides; k++)
+        packed->pos[k] = arg.start_of[k * PACKED_STRIDE];
+    free(arg.start_of);
+
+    //a mapped snapshot keeps its pages, the file stays as it is
+    if(g->map == NULL)
+        free(g->sources);
+    g->sources = NULL;
+
+    xgettimeofday(&end, take_time, HERE);
+
+    if(take_time){
+        const size_t total = packed->bytes + strides * sizeof(size_t);
+        fprintf(stderr, "compress time\t\t%.6f sec\n", exctract_time(start, end, take_time));
+        fprintf(stderr, "compressed lists\t%zu bytes, %.2f bytes/edge (%.2fx smaller)\n",
+            total, (g->edges > 0) ? (double)total / g->edges : 0.0,
+            (total > 0) ? (double)g->edges * sizeof(int) / total : 0.0);
+    }
+}
+
+/**
+ * ------------------------------------------
+ * Edge delta
+ * ------------------------------------------
+ * An edit is one line "+ ori dest" (insert) or "- ori dest"
+ * (remove), node ids as in the graph file. Edits are sorted
+ * by (dest, ori, line): the last edit of an edge wins.
+ * Inserting an edge already present or removing a missing
+ * one changes nothing, invalid edges are discarded like in
+ * the parser
+ */
+typedef struct delta_edit{
+    uint64_t    key;        //dest << 32 | ori
+    long        line;
+    bool        insert;
+}delta_edit;
+
+static int cmp_edit(const void *a, const void *b){
+    const delta_edit *x = (const delta_edit *)a;
+    const delta_edit *y = (const delta_edit *)b;
+
+    if(x->key != y->key)
+        return (x->key > y->key) - (x->key < y->key);
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static bool list_contains(const int *list, edge_t length, int value){
+    edge_t lo = 0, hi = length;
+
+    while(lo < hi){
+        edge_t mid = lo + (hi - lo) / 2;
+        if(list[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < length && list[lo] == value;
+}
+
+graph *graph_apply_delta(graph *g, const char *path, bool take_time){
+    struct timeval start, end;
+    xgettimeofday(&start, take_time, HERE);
+
+    FILE *file          = xfopen(path, "r", HERE);
+    delta_edit *edits   = NULL;
+    int count = 0, size = 0, discarded = 0;
+    long lines = 0;
+
+    char *buff  = NULL;
+    size_t len  = 0;
+
+    while(getline(&buff, &len, file) != -1){
+        char op;
+        int ori, dest;
+        lines++;
+
+        //blank lines may hold spaces, tabs or a \r (CRLF files)
+        const char *p = buff + strspn(buff, " \t\r\n");
+        if(*p == '\0' || *p == '%' || *p == '#')
+            continue;
+
+        if(sscanf(p, "%c %d %d", &op, &ori, &dest) != 3 || (op != '+' && op != '-')){
+            char *err_mess;
+            if(asprintf(&err_mess, "[graph_apply_delta] error parsing edit at line %ld", lines) < 0)
+                error("[graph_apply_delta] error parsing edit", HERE);
+            error(err_mess, HERE);
+        }
+
+        if(ori == dest || ori<=0 || dest <=0 || ori>g->nodes || dest>g->nodes){
+            discarded++;
+            continue;
+        }
+
+        if(count == size){
+            size    = (size > 0) ? 2 * size : 1024;
+            edits   = xrealloc(edits, size * sizeof(delta_edit), HERE);
+        }
+        edits[count].key    = ((uint64_t)(dest - 1) << 32) | (uint32_t)(ori - 1);
+        edits[count].line   = lines;
+        edits[count].insert = (op == '+');
+        count++;
+    }
+
+    free(buff);
+    xfclose(file, HERE);
+
+    qsort(edits, count, sizeof(delta_edit), cmp_edit);
+
+    //last edit of each edge, kept only if it changes the graph
+    int effective = 0;
+    int inserted = 0, removed = 0;
+    for(int e = 0; e<count; e++){
+        if(e + 1 < count && edits[e + 1].key == edits[e].key)
+            continue;
+
+        const int dest  = (int)(edits[e].key >> 32);
+        const int ori   = (int)(edits[e].key & 0xFFFFFFFFu);
+        const bool present = list_contains(g->sources + g->offsets[dest], g->offsets[dest+1] - g->offsets[dest], ori);
+
+        if(present == edits[e].insert)
+            continue;
+
+        edits[effective++] = edits[e];
+        if(edits[e].insert)
+            inserted++;
+        else
+            removed++;
+    }
+
+    /**
+     * new CSR: untouched lists are copied as they are, the
+     * edited ones are merged with their (sorted) edits
+     */
+    if(g->edges + inserted - removed > (long)EDGE_MAX)
+        error("[graph_apply_delta] more edges than a 32 bit offset can index: use pagerank64", HERE);
+
+    graph *r        = graph_alloc(g->nodes, g->edges + inserted - removed);
+    r->sources      = xmalloc(((size_t)r->edges + 1) * sizeof(int), HERE);
+    memcpy(r->out, g->out, g->nodes * sizeof(int));
+
+    int e = 0;
+
+    for(int v = 0; v<g->nodes; v++){
+        const int *list = g->sources + g->offsets[v];
+        const edge_t length = g->offsets[v+1] - g->offsets[v];
+        int *dst = r->sources + r->offsets[v];
+        edge_t n = 0;
+
+        if(e == effective || (int)(edits[e].key >> 32) != v){
+            memcpy(dst, list, length * sizeof(int));
+            r->offsets[v+1] = r->offsets[v] + length;
+            continue;
+        }
 
-                    xpthread_mutex_unlock(shared->buffer_mux,HERE);
-                xsem_post(shared->data_items,HERE);
+        edge_t j = 0;
+        for(; e < effective && (int)(edits[e].key >> 32) == v; e++){
+            const int ori = (int)(edits[e].key & 0xFFFFFFFFu);
+
+            while(j < length && list[j] < ori)
+                dst[n++] = list[j++];
+
+            if(edits[e].insert){
+                dst[n++] = ori;
+                r->out[ori]++;
+            }
+            else{
+                j++;
+                r->out[ori]--;
             }
         }
+        while(j < length)
+            dst[n++] = list[j++];
+
+        r->offsets[v+1] = r->offsets[v] + n;
+    }
 
-        //realloc vector
-        arr = xrealloc(arr,k*sizeof(int),HERE);
-        curr_obj->length = k;
-        curr_obj->vector = arr;
-    }
-
-    //insert thread termination value
-    xsem_wait(shared->free_slots,HERE);
-        xpthread_mutex_lock(shared->buffer_mux,HERE);
-            shared->pc_buffer[shared->pc_index] = THREAD_TERM;
-            shared->pc_index = (shared->pc_index + 1) % BUF_SIZE;
-        xpthread_mutex_unlock(shared->buffer_mux,HERE);
-    xsem_post(shared->data_items,HERE);
-    //puts("SORTER EXITING");
-    pthread_exit(NULL);
+    r->dead_count = 0;
+    for(int v = 0; v<r->nodes; v++)
+        if(r->out[v] == 0)
+            r->dead_count++;
+
+    free(edits);
+
+    xgettimeofday(&end, take_time, HERE);
+
+    fprintf(stderr, "Delta: %d inserted, %d removed, %d without effect, %d discarded\n",
+        inserted, removed, count - inserted - removed, discarded);
+    if(take_time)
+        fprintf(stderr, "delta time\t\t%.6f sec\n", exctract_time(start, end, take_time));
+
+    return r;
+}
+
+/**
+ * ------------------------------------------
+ * Binary snapshot of a parsed graph
+ * ------------------------------------------
+ * Written once (pagerank -o file) and mapped on later
+ * runs: the arrays of the graph point straight in the
+ * mapping, so the load costs only the checksum pass.
+ * A size check catches truncated files before reading,
+ * the checksum catches damaged ones
+ */
+static uint64_t snapshot_checksum(uint64_t h, const void *ptr, size_t bytes){
+    const uint32_t *word = (const uint32_t *)ptr;
+    for(size_t i = 0; i<bytes / sizeof(uint32_t); i++){
+        h ^= word[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static size_t snapshot_size(int64_t nodes, int64_t edges){
+    return sizeof(snapshot_header) + (nodes + 1) * sizeof(edge_t) + (edges + nodes) * sizeof(int);
+}
+
+bool graph_is_snapshot(const char *path){
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    bool ret = false;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode)){
+        if(read(fd, magic, sizeof(magic)) == sizeof(magic))
+            ret = (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0);
+    }
+    xclose(fd,HERE);
+    return ret;
+}
+
+void graph_snapshot_save(const char *path, graph *g){
+    snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version      = SNAPSHOT_VERSION;
+    header.node_bytes   = sizeof(int);
+    header.edge_bytes   = sizeof(edge_t);
+    header.nodes        = g->nodes;
+    header.edges        = g->edges;
+    header.dead_count   = g->dead_count;
+
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = snapshot_checksum(h, g->offsets, (g->nodes + 1) * sizeof(edge_t));
+    h = snapshot_checksum(h, g->sources, g->edges * sizeof(int));
+    h = snapshot_checksum(h, g->out, g->nodes * sizeof(int));
+    header.checksum     = h;
+
+    FILE *file = xfopen(path,"wb",HERE);
+    if( fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(g->offsets, sizeof(edge_t), g->nodes + 1, file) != (size_t)(g->nodes + 1) ||
+        fwrite(g->sources, sizeof(int), g->edges, file) != (size_t)g->edges ||
+        fwrite(g->out, sizeof(int), g->nodes, file) != (size_t)g->nodes){
+        error("[graph_snapshot_save] fwrite",HERE);
+    }
+    xfclose(file,HERE);
+}
+
+graph *graph_snapshot_load(const char *path){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        error("[open] snapshot",HERE);
+
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+        error("[fstat] snapshot",HERE);
+
+    if((size_t)st.st_size < sizeof(snapshot_header))
+        error("[graph_snapshot_load] truncated snapshot",HERE);
+
+    //private writable mapping: changes to the graph never reach the file
+    void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED)
+        error("[mmap] snapshot",HERE);
+    xclose(fd,HERE);
+
+    snapshot_header *header = (snapshot_header *)map;
+    if(memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        error("[graph_snapshot_load] not a snapshot",HERE);
+    if(header->version != SNAPSHOT_VERSION)
+        error("[graph_snapshot_load] unsupported snapshot version",HERE);
+    if(header->node_bytes != sizeof(int) || header->edge_bytes != sizeof(edge_t))
+        error("[graph_snapshot_load] snapshot built with different index sizes",HERE);
+    if(header->nodes < 1 || header->nodes > INT_MAX || header->edges < 0 || header->edges > (int64_t)EDGE_MAX)
+        error("[graph_snapshot_load] bad header",HERE);
+    if((size_t)st.st_size != snapshot_size(header->nodes, header->edges))
+        error("[graph_snapshot_load] truncated snapshot",HERE);
+
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    graph *g        = xmalloc(sizeof(graph),HERE);
+    g->nodes        = (int)header->nodes;
+    g->edges        = (long)header->edges;
+    g->dead_count   = (int)header->dead_count;
+    g->offsets      = (edge_t *)(header + 1);
+    g->sources      = (int *)(g->offsets + (g->nodes + 1));
+    g->out          = g->sources + g->edges;
+    g->map          = map;
+    g->map_size     = st.st_size;
+    g->packed       = NULL;
+    g->out_offsets  = NULL;
+    g->targets      = NULL;
+
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = snapshot_checksum(h, g->offsets, st.st_size - sizeof(snapshot_header));
+    if(h != header->checksum)
+        error("[graph_snapshot_load] checksum mismatch",HERE);
+
+    return g;
 }
@@ -2,71 +2,255 @@
 #define LIBGRPH
 
 #include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+
+#include "lib_threads.h"
 
 #define HERE __FILE__,__LINE__
 
 #ifndef BUF_SIZE
 #define BUF_SIZE 2048
 #endif
-#ifndef DYN_DEF
-#define DYN_DEF 100
+
+/**
+ * edge index type: node ids are always int (32 bit, half
+ * the bandwidth of the random reads), edge offsets are int
+ * by default and int64_t with -DGRAPH_EDGES64 (make
+ * pagerank64), for graphs of more than INT_MAX edges.
+ * Edge counts are long in both builds
+ */
+#ifdef GRAPH_EDGES64
+typedef int64_t edge_t;
+#define EDGE_MAX INT64_MAX
+#else
+typedef int edge_t;
+#define EDGE_MAX INT_MAX
 #endif
 
 #define THREAD_TERM -1      //should be negative or bigger than the highest graph node index
 
-typedef struct{
-    int *vector;
-    int length;
-}inmap;
+//flags of graph_parse (read mode | sort mode)
+#define PARSE_STREAM    0   //getline on main thread + parser_routine workers
+#define PARSE_MMAP      1   //mmap + chunk-parallel tokenizer (default)
+#define SORT_QSORT      0   //qsort with comparator on each list
+#define SORT_RADIX      2   //insertion sort (small lists) / LSD radix sort (default)
+
+//lists up to SORT_SMALL elements are sorted with insertion sort
+#ifndef SORT_SMALL
+#define SORT_SMALL 32
+#endif
+
+//nodes handed out at once to a worker by the dedup merge
+#ifndef MERGE_CHUNK
+#define MERGE_CHUNK 4096
+#endif
+
+/**
+ * ### Compressed in-lists
+ * -----------------------
+ * group varint of the gaps of each sorted in-list (first
+ * value as is, then the differences, all >= 0): every group
+ * of 4 values is one tag byte (2 bits per value: bytes - 1)
+ * followed by 1-4 little endian bytes per value, the last
+ * group of a list may be partial. The lists are stored one
+ * after the other and their lengths are still
+ * offsets[i+1] - offsets[i]: only the start of every
+ * PACKED_STRIDE-th list is kept in pos, the ones in between
+ * are reached by skipping the previous lists through their
+ * tags. The decoder always reads the 4 fields of a group
+ * with 4 byte loads: on a partial last group the missing
+ * fields (up to 3, read as 1 byte each) lie past the end of
+ * the list and the last load takes 4 more bytes, so data
+ * has PACKED_PAD = 3 + 4 bytes of slack
+ */
+#define PACKED_PAD (3 + 4)
 
+#ifndef PACKED_STRIDE
+#define PACKED_STRIDE 64
+#endif
+
+typedef struct packed_adj{
+    uint8_t *data;
+    size_t  *pos;           //nodes / PACKED_STRIDE + 1 entries
+    size_t  bytes;
+}packed_adj;
+
+/**
+ * in-adjacency stored as CSR (compressed sparse row):
+ * the sources of the edges entering node i are
+ * sources[offsets[i]] ... sources[offsets[i+1]-1]
+ * (sorted, without duplicates)
+ */
 typedef struct{
     int nodes;          //nodes count
-    int edges;          //valid edge count
-    inmap **in;         //vector of ptrs to inmap structs (if NULL dead end)
+    long edges;         //valid edge count
+    edge_t *offsets;    //nodes + 1 entries, offsets[nodes] == edges
+    int *sources;       //edges entries
     int *out;           //vector (one per node) with the count of outer edges
     int dead_count;
+    void *map;          //mapped snapshot backing the arrays (NULL if malloc'd)
+    size_t map_size;
+    packed_adj *packed; //compressed in-lists (sources is NULL then), NULL = none
+    edge_t *out_offsets;//out-adjacency (graph_build_out()), NULL = not built
+    int *targets;
 }graph;
 
-void inmap_push(inmap **obj, int elem, int *size)__attribute__((always_inline));
-
-void inmap_free(inmap *ptr)__attribute__((always_inline));
-
-graph *graph_alloc(int nodes, int edges);
+graph *graph_alloc(int nodes, long edges);
 
 void graph_destroy(graph *);
 
+/**
+ * growable array of (origin,destination) pairs
+ */
+typedef struct edge_buf{
+    int *vector;
+    long length;
+    long size;
+}edge_buf;
+
 typedef struct parser_new_attr{
     int id;
     int *buffer;
     int index;
     sem_t *free_slots;
     sem_t *data_items;
-    int *dyn_size;
-    inmap **in;
+    edge_buf *bucket;
     
 }parser_attr;
 
+typedef struct chunk_attr{
+    int         id;
+    int         thread_count;
+    int         nodes;
+    const char  *chunk_start;   //first byte of the range (begin of a line)
+    const char  *chunk_end;     //one past the last byte of the range
+    long        lines;          //lines read in the range
+    long        bad_line;       //local number of first malformed line (0 if none)
+    long        discarded;      //invalid edges found
+    edge_buf    *buckets;       //one per thread (owner of in[dest])
+    int         *out;
+}chunk_attr;
+
+typedef struct csr_attr{
+    int         id;
+    int         thread_count;
+    int         producers;      //rows of the buckets matrix
+    int         range_start;    //first node owned
+    int         range_end;      //one past the last node owned
+    long        total;          //edges entering the range
+    long        base;           //offset of the first edge of the range
+    edge_buf    *buckets;       //producers x thread_count matrix
+    edge_t      *cursor;        //next free slot of each list / list length
+    edge_t      *new_offsets;   //compaction destination
+    int         *new_sources;
+    graph       *graph;
+}csr_attr;
+
 typedef struct sorter_attr_shared{
-    int              pc_index;
-    int             *pc_buffer;
     graph           *graph;
-    pthread_mutex_t *buffer_mux;
-    sem_t           *free_slots;
-    sem_t           *data_items;
+    edge_t          *degree;        //length of each list after dedup
+    int             **correction;   //one per thread (allocated at first duplicate)
+    int             thread_count;
+    int             sort_mode;      //SORT_QSORT or SORT_RADIX
+    int             dead_count;     //dead-end nodes (updated by the merge)
 }sorter_attr_shared;
 
 typedef struct sorter_attr{
     sorter_attr_shared  *shared;
+    int                 id;
     int                 interval_start;
     int                 interval_end;
+    long                kept;       //edges left in the interval after dedup
 }sorter_attr;
 
-graph *graph_parse(const char *,int ,bool);
+graph *graph_parse(const char *,thread_pool *,int ,bool);
 
 void *parser_routine(void *);
 
+void *chunk_parser_routine(void *);
+
+void *csr_count_routine(void *);
+
+void *csr_scatter_routine(void *);
+
+void *csr_compact_routine(void *);
+
 int cmp(const void *a, const void *b);
 
+void insertion_sort(int *arr, int length);
+
+void radix_sort(int *arr, int *tmp, long length, int max_value);
+
 void *sorter_routine(void *);
 
+void graph_partition(graph *g, int parts, int *bounds);
+
+void dedup_merge_body(void *, int, int);
+
+/**
+ * graph_build_out()
+ * -----------------
+ * out-adjacency CSR, the transpose of the in-lists: the
+ * targets of the edges leaving node u are
+ * targets[out_offsets[u]] ... targets[out_offsets[u+1]-1],
+ * sorted. Needs `sources` (build it before graph_compress()),
+ * does nothing if already built. Built on `pool` with the
+ * count / scatter of the CSR build, the buckets take 8 bytes
+ * per edge until it returns
+ */
+void graph_build_out(graph *g, thread_pool *pool);
+
+/**
+ * graph_compress()
+ * ----------------
+ * replaces `sources` with the compressed in-lists (see
+ * packed_adj), encoded in parallel on `pool`. Only the
+ * gather of the X phase reads them: the graph can't be
+ * reordered, saved or edited afterwards. With take_time
+ * the time and the size of the lists go to stderr
+ */
+void graph_compress(graph *g, thread_pool *pool, bool take_time);
+
+/**
+ * graph_apply_delta()
+ * -------------------
+ * returns a new graph with the edits of the delta file at
+ * `path` applied ("+ ori dest" / "- ori dest" per line, ids
+ * as in the graph file, blank and '%' / '#' lines skipped):
+ * in-lists, out-degrees and dead end count are updated, the
+ * input graph is left untouched
+ */
+graph *graph_apply_delta(graph *g, const char *path, bool take_time);
+
+/**
+ * ### Binary snapshot
+ * -------------------
+ * layout: header | offsets[nodes+1] | sources[edges] | out[nodes]
+ * arrays are stored in native byte order, `checksum` covers
+ * every byte after the header. offsets are edge_t: a
+ * snapshot loads only in a build with the same edge_bytes
+ */
+#define SNAPSHOT_MAGIC      "PRGRAPH"
+#define SNAPSHOT_VERSION    1
+
+typedef struct snapshot_header{
+    char        magic[8];
+    uint32_t    version;
+    uint16_t    node_bytes;     //sizeof of a node index
+    uint16_t    edge_bytes;     //sizeof of an edge offset
+    int64_t     nodes;
+    int64_t     edges;
+    int64_t     dead_count;
+    uint64_t    checksum;
+}snapshot_header;
+
+bool graph_is_snapshot(const char *path);
+
+void graph_snapshot_save(const char *path, graph *g);
+
+graph *graph_snapshot_load(const char *path);
+
 #endif
@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define KERNELS_X86 0
+#endif
+
+/**
+ * gather_scalar()
+ * ---------------
+ * portable version: 4 accumulators break the dependency
+ * chain of the additions, the loads stay scalar
+ */
+void gather_scalar(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end){
+    for(int i = start; i<end; i++){
+        const edge_t in_end = offsets[i+1];
+        edge_t j = offsets[i];
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+
+        for(; j + 4 <= in_end; j += 4){
+            s0 += Y[sources[j]];
+            s1 += Y[sources[j+1]];
+            s2 += Y[sources[j+2]];
+            s3 += Y[sources[j+3]];
+        }
+        for(; j < in_end; j++)
+            s0 += Y[sources[j]];
+
+        sums[i - start] = (s0 + s1) + (s2 + s3);
+    }
+}
+
+void gather_scalar_f(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end){
+    for(int i = start; i<end; i++){
+        const edge_t in_end = offsets[i+1];
+        edge_t j = offsets[i];
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+
+        for(; j + 4 <= in_end; j += 4){
+            s0 += Y[sources[j]];
+            s1 += Y[sources[j+1]];
+            s2 += Y[sources[j+2]];
+            s3 += Y[sources[j+3]];
+        }
+        for(; j < in_end; j++)
+            s0 += Y[sources[j]];
+
+        sums[i - start] = (s0 + s1) + (s2 + s3);
+    }
+}
+
+/**
+ * packed_seek()
+ * -------------
+ * first byte of list i: from the closest pos[] entry, the
+ * lists in between are skipped through their tags alone
+ * (bytes of a group = tag + values + the 2 bit fields,
+ * unused fields are 0)
+ */
+static inline const uint8_t *packed_seek(const edge_t *offsets, const packed_adj *packed, int i){
+    const int first     = i - i % PACKED_STRIDE;
+    const uint8_t *p    = packed->data + packed->pos[first / PACKED_STRIDE];
+
+    for(int k = first; k<i; k++){
+        edge_t length = offsets[k+1] - offsets[k];
+
+        for(; length > 0; length -= 4){
+            const unsigned tag = *p;
+            p += 1 + ((length < 4) ? length : 4) + (tag & 3) + ((tag >> 2) & 3) + ((tag >> 4) & 3) + (tag >> 6);
+        }
+    }
+    return p;
+}
+
+static inline uint32_t packed_load(const uint8_t *p){
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static const uint32_t packed_mask[4] = {0xFFu, 0xFFFFu, 0xFFFFFFu, 0xFFFFFFFFu};
+
+/**
+ * packed_group()
+ * --------------
+ * decodes the (up to 4) gaps of the group at *p into
+ * absolute ids, starting from *prev; unaligned 4 byte loads
+ * masked to the length of each value. The fields past a
+ * partial group belong to the next list (or to the
+ * PACKED_PAD slack after the last one): they stay inside
+ * the buffer, their ids are never used
+ */
+static inline void packed_group(const uint8_t **p, int *prev, int *ids){
+    const unsigned tag  = **p;
+    const unsigned l0   = tag & 3, l1 = (tag >> 2) & 3, l2 = (tag >> 4) & 3, l3 = tag >> 6;
+    const uint8_t *q0   = *p + 1;
+    const uint8_t *q1   = q0 + l0 + 1;
+    const uint8_t *q2   = q1 + l1 + 1;
+    const uint8_t *q3   = q2 + l2 + 1;
+
+    ids[0]  = *prev  + (int)(packed_load(q0) & packed_mask[l0]);
+    ids[1]  = ids[0] + (int)(packed_load(q1) & packed_mask[l1]);
+    ids[2]  = ids[1] + (int)(packed_load(q2) & packed_mask[l2]);
+    ids[3]  = ids[2] + (int)(packed_load(q3) & packed_mask[l3]);
+    *prev   = ids[3];
+    *p      = q3 + l3 + 1;
+}
+
+/**
+ * gather_packed()
+ * ---------------
+ * gather over the compressed in-lists (graph_compress()):
+ * [start, end) is decoded in one pass, 4 accumulators like
+ * gather_scalar(). A partial last group decodes its unused
+ * (0 byte) fields too, only the real values are summed, the
+ * pointer is then moved back to the end of the list
+ */
+void gather_packed(const edge_t *offsets, const packed_adj *packed, const double *Y, double *sums, int start, int end){
+    const uint8_t *p = packed_seek(offsets, packed, start);
+
+    for(int i = start; i<end; i++){
+        edge_t length   = offsets[i+1] - offsets[i];
+        int prev        = 0;
+        int ids[4];
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+
+        for(; length >= 4; length -= 4){
+            packed_group(&p, &prev, ids);
+            s0 += Y[ids[0]];
+            s1 += Y[ids[1]];
+            s2 += Y[ids[2]];
+            s3 += Y[ids[3]];
+        }
+        if(length > 0){
+            packed_group(&p, &prev, ids);
+            p -= 4 - length;
+            for(edge_t k = 0; k<length; k++)
+                s0 += Y[ids[k]];
+        }
+
+        sums[i - start] = (s0 + s1) + (s2 + s3);
+    }
+}
+
+void gather_packed_f(const edge_t *offsets, const packed_adj *packed, const float *Y, double *sums, int start, int end){
+    const uint8_t *p = packed_seek(offsets, packed, start);
+
+    for(int i = start; i<end; i++){
+        edge_t length   = offsets[i+1] - offsets[i];
+        int prev        = 0;
+        int ids[4];
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+
+        for(; length >= 4; length -= 4){
+            packed_group(&p, &prev, ids);
+            s0 += Y[ids[0]];
+            s1 += Y[ids[1]];
+            s2 += Y[ids[2]];
+            s3 += Y[ids[3]];
+        }
+        if(length > 0){
+            packed_group(&p, &prev, ids);
+            p -= 4 - length;
+            for(edge_t k = 0; k<length; k++)
+                s0 += Y[ids[k]];
+        }
+
+        sums[i - start] = (s0 + s1) + (s2 + s3);
+    }
+}
+
+#if KERNELS_X86
+
+/**
+ * gather_avx2()
+ * -------------
+ * 8 in-edges per step (two 4 x double gathers), then one
+ * more 4-wide step and a scalar tail. Lists shorter than
+ * 4 never touch the vector units
+ */
+__attribute__((target("avx2")))
+void gather_avx2(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end){
+    for(int i = start; i<end; i++){
+        const edge_t in_end = offsets[i+1];
+        edge_t j = offsets[i];
+        double sum = 0.0;
+
+        if(in_end - j >= 4){
+            __m256d acc0 = _mm256_setzero_pd();
+            __m256d acc1 = _mm256_setzero_pd();
+
+            for(; j + 8 <= in_end; j += 8){
+                __m128i idx0 = _mm_loadu_si128((const __m128i *)(sources + j));
+                __m128i idx1 = _mm_loadu_si128((const __m128i *)(sources + j + 4));
+                acc0 = _mm256_add_pd(acc0, _mm256_i32gather_pd(Y, idx0, 8));
+                acc1 = _mm256_add_pd(acc1, _mm256_i32gather_pd(Y, idx1, 8));
+            }
+            if(j + 4 <= in_end){
+                __m128i idx0 = _mm_loadu_si128((const __m128i *)(sources + j));
+                acc0 = _mm256_add_pd(acc0, _mm256_i32gather_pd(Y, idx0, 8));
+                j += 4;
+            }
+
+            acc0 = _mm256_add_pd(acc0, acc1);
+            __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+            sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        }
+
+        for(; j < in_end; j++)
+            sum += Y[sources[j]];
+
+        sums[i - start] = sum;
+    }
+}
+
+/**
+ * gather_avx512()
+ * ---------------
+ * 16 in-edges per step (two 8 x double gathers), the
+ * remainder is loaded and gathered under a mask, so there
+ * is no scalar tail
+ */
+__attribute__((target("avx512f,avx512vl")))
+void gather_avx512(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end){
+    for(int i = start; i<end; i++){
+        const edge_t in_end = offsets[i+1];
+        edge_t j = offsets[i];
+
+        if(in_end - j < 4){
+            double sum = 0.0;
+            for(; j < in_end; j++)
+                sum += Y[sources[j]];
+            sums[i - start] = sum;
+            continue;
+        }
+
+        __m512d acc0 = _mm512_setzero_pd();
+        __m512d acc1 = _mm512_setzero_pd();
+
+        for(; j + 16 <= in_end; j += 16){
+            __m256i idx0 = _mm256_loadu_si256((const __m256i *)(sources + j));
+            __m256i idx1 = _mm256_loadu_si256((const __m256i *)(sources + j + 8));
+            acc0 = _mm512_add_pd(acc0, _mm512_i32gather_pd(idx0, Y, 8));
+            acc1 = _mm512_add_pd(acc1, _mm512_i32gather_pd(idx1, Y, 8));
+        }
+        if(j + 8 <= in_end){
+            __m256i idx0 = _mm256_loadu_si256((const __m256i *)(sources + j));
+            acc0 = _mm512_add_pd(acc0, _mm512_i32gather_pd(idx0, Y, 8));
+            j += 8;
+        }
+        if(j < in_end){
+            const __mmask8 mask = (__mmask8)((1u << (in_end - j)) - 1);
+            __m256i idx0 = _mm256_maskz_loadu_epi32(mask, sources + j);
+            acc1 = _mm512_add_pd(acc1, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, idx0, Y, 8));
+        }
+
+        sums[i - start] = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    }
+}
+
+/**
+ * gather_avx2_f()
+ * ---------------
+ * 8 in-edges per step: one 8 x float gather, both halves
+ * widened to double before the accumulation
+ */
+__attribute__((target("avx2")))
+void gather_avx2_f(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end){
+    for(int i = start; i<end; i++){
+        const edge_t in_end = offsets[i+1];
+        edge_t j = offsets[i];
+        double sum = 0.0;
+
+        if(in_end - j >= 8){
+            __m256d acc0 = _mm256_setzero_pd();
+            __m256d acc1 = _mm256_setzero_pd();
+
+            for(; j + 8 <= in_end; j += 8){
+                __m256i idx = _mm256_loadu_si256((const __m256i *)(sources + j));
+                __m256  val = _mm256_i32gather_ps(Y, idx, 4);
+                acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(val)));
+                acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(val, 1)));
+            }
+
+            acc0 = _mm256_add_pd(acc0, acc1);
+            __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+            sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        }
+
+        for(; j < in_end; j++)
+            sum += Y[sources[j]];
+
+        sums[i - start] = sum;
+    }
+}
+
+/**
+ * gather_avx512_f()
+ * -----------------
+ * 16 in-edges per step (one 16 x float gather), masked
+ * remainder as in gather_avx512()
+ */
+__attribute__((target("avx512f,avx512vl")))
+void gather_avx512_f(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end){
+    for(int i = start; i<end; i++){
+        const edge_t in_end = offsets[i+1];
+        edge_t j = offsets[i];
+
+        if(in_end - j < 4){
+            double sum = 0.0;
+            for(; j < in_end; j++)
+                sum += Y[sources[j]];
+            sums[i - start] = sum;
+            continue;
+        }
+
+        __m512d acc0 = _mm512_setzero_pd();
+        __m512d acc1 = _mm512_setzero_pd();
+        __m512  val;
+
+        for(; j + 16 <= in_end; j += 16){
+            __m512i idx = _mm512_loadu_si512((const void *)(sources + j));
+            val  = _mm512_i32gather_ps(idx, Y, 4);
+            acc0 = _mm512_add_pd(acc0, _mm512_cvtps_pd(_mm512_castps512_ps256(val)));
+            acc1 = _mm512_add_pd(acc1, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(val), 1))));
+        }
+        if(j < in_end){
+            const __mmask16 mask = (__mmask16)((1u << (in_end - j)) - 1);
+            __m512i idx = _mm512_maskz_loadu_epi32(mask, sources + j);
+            val  = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, idx, Y, 4);
+            acc0 = _mm512_add_pd(acc0, _mm512_cvtps_pd(_mm512_castps512_ps256(val)));
+            acc1 = _mm512_add_pd(acc1, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(val), 1))));
+        }
+
+        sums[i - start] = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    }
+}
+
+#else
+
+void gather_avx2(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end){
+    gather_scalar(offsets, sources, Y, sums, start, end);
+}
+
+void gather_avx512(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end){
+    gather_scalar(offsets, sources, Y, sums, start, end);
+}
+
+void gather_avx2_f(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end){
+    gather_scalar_f(offsets, sources, Y, sums, start, end);
+}
+
+void gather_avx512_f(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end){
+    gather_scalar_f(offsets, sources, Y, sums, start, end);
+}
+
+#endif
+
+static int gather_supported(int kernel){
+#if KERNELS_X86
+    __builtin_cpu_init();
+    switch(kernel){
+        case KERNEL_AVX512: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl");
+        case KERNEL_AVX2:   return __builtin_cpu_supports("avx2");
+        default:            return 1;
+    }
+#else
+    return kernel == KERNEL_SCALAR;
+#endif
+}
+
+static int gather_resolve(int kernel, int *chosen){
+    if(kernel == KERNEL_AUTO || kernel > KERNEL_AVX512)
+        kernel = KERNEL_AVX512;
+
+    while(kernel > KERNEL_SCALAR && !gather_supported(kernel))
+        kernel--;
+
+    if(chosen != NULL)
+        *chosen = kernel;
+
+    return kernel;
+}
+
+gather_fn gather_select(int kernel, int *chosen){
+    switch(gather_resolve(kernel, chosen)){
+        case KERNEL_AVX512: return gather_avx512;
+        case KERNEL_AVX2:   return gather_avx2;
+        default:            return gather_scalar;
+    }
+}
+
+gather_f_fn gather_f_select(int kernel, int *chosen){
+    switch(gather_resolve(kernel, chosen)){
+        case KERNEL_AVX512: return gather_avx512_f;
+        case KERNEL_AVX2:   return gather_avx2_f;
+        default:            return gather_scalar_f;
+    }
+}
+
+const char *gather_name(int kernel){
+    static const char *names[] = {"auto", "scalar", "avx2", "avx512"};
+    if(kernel < KERNEL_AUTO || kernel > KERNEL_AVX512)
+        return "unknown";
+    return names[kernel];
+}
@@ -0,0 +1,71 @@
+#ifndef LIBKRNL
+#define LIBKRNL
+
+#include "lib_graph.h"
+
+/**
+ * ### Gather Kernels
+ * ------------------
+ * Inner loop of the X phase: for each node i in [start, end)
+ *
+ *      sums[i - start] = sum of Y[sources[j]], offsets[i] <= j < offsets[i+1]
+ *
+ * The *_f versions read a float Y (half the bandwidth of
+ * the random reads) and still accumulate in double.
+ *
+ * The scalar version uses 4 independent accumulators, the
+ * x86 versions use the AVX2 / AVX-512 gather instructions
+ * with two vector accumulators (long in-lists hide the gather
+ * latency). The version is picked at runtime from the cpu
+ * features (gather_select()), the executable itself is still
+ * compiled for the baseline x86-64.
+ *
+ * Summation order differs between versions: results agree
+ * up to rounding.
+ */
+
+#define KERNEL_AUTO     0
+#define KERNEL_SCALAR   1
+#define KERNEL_AVX2     2
+#define KERNEL_AVX512   3
+
+typedef void (*gather_fn)(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end);
+
+void gather_scalar(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end);
+
+void gather_avx2(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end);
+
+void gather_avx512(const edge_t *offsets, const int *sources, const double *Y, double *sums, int start, int end);
+
+typedef void (*gather_f_fn)(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end);
+
+void gather_scalar_f(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end);
+
+void gather_avx2_f(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end);
+
+void gather_avx512_f(const edge_t *offsets, const int *sources, const float *Y, double *sums, int start, int end);
+
+/**
+ * compressed in-lists (graph_compress()), scalar only: the
+ * decoding is the bottleneck, not the loads of Y
+ */
+void gather_packed(const edge_t *offsets, const packed_adj *packed, const double *Y, double *sums, int start, int end);
+
+void gather_packed_f(const edge_t *offsets, const packed_adj *packed, const float *Y, double *sums, int start, int end);
+
+/**
+ * gather_select()
+ * ---------------
+ * returns the kernel for the `kernel` request (KERNEL_*):
+ * KERNEL_AUTO takes the widest one supported by the cpu,
+ * an explicit request not supported falls back to the next
+ * narrower one. If `chosen` is not NULL it is set to the
+ * KERNEL_* actually used
+ */
+gather_fn gather_select(int kernel, int *chosen);
+
+gather_f_fn gather_f_select(int kernel, int *chosen);
+
+const char *gather_name(int kernel);
+
+#endif
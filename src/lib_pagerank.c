@@ -5,16 +5,19 @@
 #include <math.h>
 #include <string.h>
 #include <signal.h>
+#include <unistd.h>
+#include <time.h>
 #include <sys/time.h>
 #include <bits/sigaction.h>
 
 #include "lib_pagerank.h"
 #include "lib_supp.h"
+#include "lib_threads.h"
 
 #define HERE __FILE__,__LINE__
 
 void printHelp(const char *name){
-    printf("usage: %s [-h] [-s] [-k K] [-m M] [-d D] [-e E] [-t T] infile\n",name);
+    printf("usage: %s [-h] [-s] [-k K] [-m M] [-d D] [-e E] [-t T] [-p P] [-o SNAPSHOT] infile\n",name);
     puts("");
     puts("Compute pagerank for a directed graph represented by the list of its edges");
     puts("following the Matrix Market format: https://math.nist.gov/MatrixMarket/formats.html#MMformat");
@@ -26,7 +29,7 @@ void printHelp(const char *name){
     puts("Display the k highest ranked nodes (default k=3)");
     puts("");
     puts("positional arguments:");
-    puts("infile:\t\tinput file");
+    puts("infile:\t\tinput file (.mtx or binary snapshot written with -o)");
     puts("");
     puts("options:");
     puts("-h\t\tshow this help message and exit");
@@ -36,68 +39,241 @@ void printHelp(const char *name){
     puts("-e E\t\tmax error (default 1.0e7)");
     puts("-t T\t\tthreads count (default 3)");
     puts("-s\t\tEnable signal handler (SIGUSR1 to print current max node)");
+    puts("-o SNAPSHOT\twrite the parsed graph as a binary snapshot (load it passing it as infile)");
+    puts("--parse MODE\tgraph reader: mmap (default, chunk-parallel) or stream (getline)");
+    puts("--sort MODE\tadjacency sort: radix (default, insertion/radix) or qsort");
+    puts("--schedule MODE\tX phase split: edges (default, same in-edges per thread), nodes or dynamic");
+    puts("-p P\t\trank vectors precision: double (default), float or mixed (float Y, double X)");
+    puts("--solver S\titeration scheme: jacobi (default) or gauss-seidel (in place, one rank vector, double only)");
+    puts("--adaptive T\tfreeze the in-edge sums whose relative change stays below T (jacobi, -p double or mixed)");
+    puts("--extrapolate E\tevery 10 iterations extrapolate the iterates: none (default), aitken or quadratic");
+    puts("--teleport F\tpersonalized pagerank: the random jumps land on the \"node [weight]\" lines of F (1-based file ids)");
+    puts("--batch F\tpersonalized pagerank of every seed set of F, one \"node[:weight] ...\" set per line (1-based file ids)");
+    puts("--batch-size B\tseed sets computed together by --batch (default 8)");
+    puts("--delta F\tapply the edge edits of F (\"+ ori dest\" / \"- ori dest\" lines) before pagerank");
+    puts("--warm F\tstart from the rank vector saved in F instead of the uniform vector");
+    puts("--save-ranks F\tsave the final rank vector in F (input of --warm)");
+    puts("--serve S\tkeep the graph in memory and answer RANK/TOP/RECOMPUTE/STATUS/STATS requests on the UNIX socket S");
+    puts("--metrics F\twrite error, S_t, phase times, edges/s and barrier waits of every iteration to F, one JSON object per line");
+    puts("--perf F\twrite per phase and per iteration counters (perf_event_open) to F, one JSON object per line");
+    puts("--compress\tstore the in-lists as group varint gaps, decoded by the X phase (not with gauss-seidel or --batch)");
+    puts("--shards F\twrite the graph as a shard file (by destination, --shard-mb S MB each, default 64): given as infile it runs semi-external");
+    puts("--direction D\tX phase direction: pull (default, in-lists), push (out-lists into per-thread bins) or auto (times one iteration of each at the start, then keeps the faster for the whole run)");
+    puts("--kernel K\tX phase gather kernel: auto (default, widest supported), scalar, avx2 or avx512");
+    puts("--reorder R\trelabel the nodes before pagerank: none (default), degree or rcm");
+    puts("--balance\tprint the per-thread load of the X phase on stderr");
 }
 
 inline void printGraphInfo(graph *g,FILE *stream,bool comment){
 
     if(!comment)
-        fprintf(stream, "Number of nodes: %d \nNumber of dead-end nodes: %d\nNumber of valid arcs: %d\n", g->nodes, g->dead_count, g->edges);
+        fprintf(stream, "Number of nodes: %d \nNumber of dead-end nodes: %d\nNumber of valid arcs: %ld\n", g->nodes, g->dead_count, g->edges);
     else
-        fprintf(stream, "%%Number of nodes: %d \n%%Number of dead-end nodes: %d\n%%Number of valid arcs: %d\n", g->nodes, g->dead_count, g->edges);
+        fprintf(stream, "%%Number of nodes: %d \n%%Number of dead-end nodes: %d\n%%Number of valid arcs: %ld\n", g->nodes, g->dead_count, g->edges);
 }
 
-/*
- * Returns the list of indexes: one for every k max
- * ------------------------------------------------
- * Implemented as a repeated search for max, still
- * asymptotically better than heapsort, at worst (k == n)
- * is Theta(n^2)
-*/
-int *find_K_Max(double *ranks, int length,int k){
-    int     *index      = xmalloc(k * sizeof(int),      HERE);
-    double  *max_ranks  = xmalloc(k * sizeof(double),   HERE);
+/**
+ * ### Top k
+ * ---------
+ * Each task keeps a bounded min-heap of the best k nodes of
+ * its range (root: the worst one kept), the heaps are then
+ * merged and the candidates sorted. O(n log k) over the
+ * threads, plus O(T k log(T k)) for the merge.
+ * Node a beats node b if its rank is higher, or on equal
+ * ranks if its id is lower: the result does not depend on
+ * the number of threads. `ranks` is only read
+ */
+typedef struct topk_attr{
+    const double    *ranks;
+    int             start;
+    int             end;
+    int             k;
+    int             *heap;
+    int             size;
+}topk_attr;
+
+static inline bool topk_beats(const double *ranks, int a, int b){
+    return (ranks[a] > ranks[b]) || (ranks[a] == ranks[b] && a < b);
+}
 
-    double  max;
-    int     max_idx;
+static void topk_sift_down(const double *ranks, int *heap, int size, int i){
+    for(;;){
+        int worst = i;
+        const int l = 2 * i + 1;
+        const int r = l + 1;
+
+        if(l < size && topk_beats(ranks, heap[worst], heap[l]))
+            worst = l;
+        if(r < size && topk_beats(ranks, heap[worst], heap[r]))
+            worst = r;
+        if(worst == i)
+            return;
 
-    //loop for each max;
-    for(int i = 0; i<k; i++){
-        max     = ranks[0];
-        max_idx = 0;
+        const int tmp   = heap[i];
+        heap[i]         = heap[worst];
+        heap[worst]     = tmp;
+        i = worst;
+    }
+}
 
-        for(int j = 1; j<length; j++){
-            if(ranks[j] > max){
-                max     = ranks[j];
-                max_idx = j;
+static void *topk_routine(void *attr){
+    topk_attr *arg      = (topk_attr *)attr;
+    const double *ranks = arg->ranks;
+    int *heap           = arg->heap;
+    int size            = 0;
+
+    for(int v = arg->start; v<arg->end; v++){
+        if(size < arg->k){
+            //sift up
+            int i = size++;
+            heap[i] = v;
+            while(i > 0 && topk_beats(ranks, heap[(i - 1) / 2], heap[i])){
+                const int parent    = (i - 1) / 2;
+                const int tmp       = heap[i];
+                heap[i]             = heap[parent];
+                heap[parent]        = tmp;
+                i = parent;
             }
         }
+        else if(topk_beats(ranks, v, heap[0])){
+            heap[0] = v;
+            topk_sift_down(ranks, heap, size, 0);
+        }
+    }
 
-        max_ranks[i]    = max;
-        index[i]        = max_idx;
-        ranks[max_idx]  = -1;
+    arg->size = size;
+    return NULL;
+}
+
+//candidate of the merge: the rank is copied, the comparator needs no state
+typedef struct topk_entry{
+    double  rank;
+    int     id;
+}topk_entry;
+
+static int cmp_topk(const void *a, const void *b){
+    const topk_entry *x = (const topk_entry *)a;
+    const topk_entry *y = (const topk_entry *)b;
+
+    if(x->rank != y->rank)
+        return (x->rank < y->rank) - (x->rank > y->rank);
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+int *find_K_Max(const double *ranks, int length, int k, thread_pool *pool){
+    if(k > length)
+        k = length;
+    if(k <= 0)
+        return xmalloc(sizeof(int), HERE);
+
+    //small inputs (or no pool): one range
+    int parts = (pool != NULL) ? pool->size : 1;
+    if((long)length < (long)parts * TOPK_MIN_RANGE)
+        parts = (int)(length / TOPK_MIN_RANGE) + 1;
+
+    topk_attr attr[parts];
+    int *heaps = xmalloc((size_t)parts * k * sizeof(int), HERE);
+
+    for(int p = 0; p<parts; p++){
+        attr[p].ranks   = ranks;
+        attr[p].start   = (int)(((long)length * p) / parts);
+        attr[p].end     = (int)(((long)length * (p + 1)) / parts);
+        attr[p].k       = k;
+        attr[p].heap    = heaps + (size_t)p * k;
+        attr[p].size    = 0;
     }
 
-    //clean the ranks array (rewrite all -1)
-    for(int i = 0; i<k; i++){
-        ranks[index[i]] = max_ranks[i];
+    if(parts == 1)
+        topk_routine(&attr[0]);
+    else{
+        for(int p = 0; p<parts; p++)
+            pool_submit(pool, topk_routine, &attr[p]);
+        pool_wait(pool);
+    }
+
+    //merge: candidates of every range, sorted best first
+    int count = 0;
+    for(int p = 0; p<parts; p++)
+        count += attr[p].size;
+
+    topk_entry *merge = xmalloc((size_t)count * sizeof(topk_entry), HERE);
+    count = 0;
+    for(int p = 0; p<parts; p++){
+        for(int i = 0; i<attr[p].size; i++){
+            merge[count].rank   = ranks[attr[p].heap[i]];
+            merge[count].id     = attr[p].heap[i];
+            count++;
+        }
     }
+    free(heaps);
+
+    qsort(merge, count, sizeof(topk_entry), cmp_topk);
+
+    int *index = xmalloc((k + 1) * sizeof(int), HERE);
+    for(int i = 0; i<k; i++)
+        index[i] = merge[i].id;
+    free(merge);
 
-    free(max_ranks);
     return index;
 }
 
-void printStats(double *ranks,int length,int iter_count,int max_iter,int k, FILE *stream){
+void ranks_save(const char *path, const double *ranks, int nodes){
+    char magic[8] = RANKS_MAGIC;
+    int64_t count = nodes;
+
+    FILE *file = xfopen(path,"wb",HERE);
+    if( fwrite(magic, sizeof(magic), 1, file) != 1 ||
+        fwrite(&count, sizeof(count), 1, file) != 1 ||
+        fwrite(ranks, sizeof(double), nodes, file) != (size_t)nodes){
+        error("[ranks_save] fwrite",HERE);
+    }
+    xfclose(file,HERE);
+}
+
+double *ranks_load(const char *path, int nodes){
+    char magic[8];
+    int64_t count;
+
+    FILE *file = xfopen(path,"rb",HERE);
+    if( fread(magic, sizeof(magic), 1, file) != 1 || memcmp(magic, RANKS_MAGIC, sizeof(magic)) != 0)
+        error("[ranks_load] not a rank vector",HERE);
+    if( fread(&count, sizeof(count), 1, file) != 1 || count != nodes)
+        error("[ranks_load] node count differs from the graph",HERE);
+
+    double *ranks = xmalloc(nodes * sizeof(double), HERE);
+    if( fread(ranks, sizeof(double), nodes, file) != (size_t)nodes)
+        error("[ranks_load] truncated rank vector",HERE);
+    xfclose(file,HERE);
+
+    double sum = 0.0;
+    for(int i = 0; i<nodes; i++)
+        sum += ranks[i];
+    if(!(sum > 0.0))
+        error("[ranks_load] empty rank vector",HERE);
+    for(int i = 0; i<nodes; i++)
+        ranks[i] /= sum;
+
+    return ranks;
+}
+
+void printStats(const double *ranks,int length,int iter_count,int max_iter,double error,int k, thread_pool *pool, FILE *stream){
     double sum_ranks = 0;
     for(int i = 0; i<length; i++){
         sum_ranks += ranks[i];
     }
 
-    int *max_index = find_K_Max(ranks,length,k);
+    if(k > length)
+        k = length;
+    if(k < 0)
+        k = 0;
+
+    int *max_index = find_K_Max(ranks,length,k,pool);
     if(iter_count == max_iter)
         fprintf(stream,"Did not converge after %d iterations\n", iter_count);
     else
         fprintf(stream,"Converged after %d iterations\n", iter_count);
 
+    fprintf(stream,"Final error: %e\n",error);
     fprintf(stream,"Sum of ranks: %f (should be 1)\n",sum_ranks);
     fprintf(stream, "Top %d nodes:\n",k);
 
@@ -118,213 +294,1404 @@ void printStats(double *ranks,int length,int iter_count,int max_iter,int k, FILE
  *          double          **X_current;
  *          double          **X_previous;
  *          double          *Y;
+ *          float           **Xf_current;
+ *          float           **Xf_previous;
+ *          float           *Yf;
+ *          double          *inv_out;
+ *          int             precision;
+ *          int             solver;
+ *          double          error;
+ *          unsigned char   *frozen;
+ *          double          *adapt_sums;
+ *          double          adapt_tol;
+ *          bool            adapt_full;
+ *          int             adapt_since;
+ *          int             adapt_checks;
+ *          long            adapt_edges;
+ *          const double    *teleport;
+ *          const double    *init;
+ *          int             extrapolate;
+ *          double          *history[EXTRAP_HISTORY];
+ *          double          extrap_coef[3];
+ *          double          extrap_scale;
+ *          int             extrapolations;
+ *          int             extrap_rejected;
+ *          bool            extrap_pending;
+ *          bool            extrap_restore;
+ *          double          extrap_error;
+ *          double          extrap_S_t;
+ *          int             iteration;
+ *          long            *active_log;
+ *          int             log_len;
+ *          perf_sample     *perf_log;
+ *          int             perf_iter;
+ *          FILE            *metrics;
+ *          pagerank_metrics *metrics_log;
+ *          double          metrics_error[2];
+ *          double          metrics_S_t[2];
+ *          gather_fn       gather;
+ *          gather_f_fn     gather_f;
+ *          int             direction;
+ *          bool            push;
+ *          int             *push_src;
+ *          int             *push_dst;
+ *          edge_t          *bin_start;
+ *          int             *bin_target;
+ *          double          *bin_value;
+ *          double          probe_mark;
+ *          double          probe_time[2];
  *          double          S_t;
- *          double          S_t_shared;
+ *          double          mass;
  *          double          epsilon;
- *          double          error;
  *          double          dumping_factor;
  *          graph           *grph;
  *          int             max_iter;
- *          bool            do_X;
- *          bool            do_Y;
  *          bool            exit;
- *          int             waiting_on_Y;
- *          int             waiting_on_X;
  *          int             *curr_iter;
  *          int             thread_count;
- *          pthread_mutex_t *cond_mux;
+ *          pagerank_partial *partial;
+ *          int             schedule;
+ *          int             *bounds;
+ *          int             chunk_count;
+ *          int             next_chunk;
+ *          bool            timed;
+ *          spin_barrier    *barrier;
  *          pthread_mutex_t *shared_mux;
- *          pthread_cond_t  *cond;
  *      } pagerank_shared_attr;
  *
  *      typedef struct pagerank_thread_attr{
+ *          int id;
  *          int interval_start;
  *          int interval_end;
+ *          long nodes;
+ *          long edges;
+ *          double busy;
  *          pagerank_shared_attr *shared;
  *      } pagerank_thread_attr;
+ * ---------------------------------------------------------------------------
+ * Each iteration crosses the spin barrier twice (after Y and
+ * after X). At the second one the last thread to arrive
+ * reduces the per-thread partial sums, swaps the vectors
+ * and releases the others
+ *
+ * The Y phase costs the same for every node and runs on the
+ * equal node range [interval_start, interval_end). The X phase
+ * costs the in-degree of the node and runs on the ranges of
+ * shared->bounds, balanced on the in-edges: the thread own
+ * range (static schedules) or the chunks it takes from the
+ * shared counter (dynamic schedule)
  * -------------------------------------------------------------------
  */
+
+/**
+ * pagerank_jump()
+ * ---------------
+ * rank a node gets from the random jumps: the teleport
+ * (1-d) and the dead end mass d * S_t, both spread on the
+ * teleport vector (uniform 1/n when it is NULL). The
+ * Gauss-Seidel sweep leaves the dead end term out
+ */
+static inline double pagerank_jump_scale(const pagerank_shared_attr *shared, bool dead_ends){
+    const double d      = shared->dumping_factor;
+    const double jump   = (1.0 - d) + (dead_ends ? d * shared->S_t : 0.0);
+
+    return (shared->teleport != NULL) ? jump : jump / (double)(shared->grph->nodes);
+}
+
+static inline double pagerank_jump(const double *teleport, double jump, int i){
+    return (teleport != NULL) ? jump * teleport[i] : jump;
+}
+
+/**
+ * pagerank_sum() / pagerank_sum_f()
+ * ---------------------------------
+ * in-edge sums of [start, end) into sums: the selected
+ * gather kernel, or the decoder of the compressed in-lists
+ * when the graph has them (graph_compress())
+ */
+static inline void pagerank_sum(pagerank_shared_attr *shared, double *sums, int start, int end){
+    const graph *g = shared->grph;
+
+    if(g->packed != NULL)
+        gather_packed(g->offsets, g->packed, shared->Y, sums, start, end);
+    else
+        shared->gather(g->offsets, g->sources, shared->Y, sums, start, end);
+}
+
+static inline void pagerank_sum_f(pagerank_shared_attr *shared, double *sums, int start, int end){
+    const graph *g = shared->grph;
+
+    if(g->packed != NULL)
+        gather_packed_f(g->offsets, g->packed, shared->Yf, sums, start, end);
+    else
+        shared->gather_f(g->offsets, g->sources, shared->Yf, sums, start, end);
+}
+
+/**
+ * pagerank_update()
+ * -----------------
+ * end of the X phase over [start, end), X_curr holding the
+ * in-edge sums: adds the jump, accumulates the dead end
+ * mass and the L1 error of the range
+ */
+static inline void pagerank_update(pagerank_shared_attr *shared, int start, int end, pagerank_partial *acc){
+    const graph  *g         = shared->grph;
+    const double *X_prev    = *(shared->X_previous);
+    double       *X_curr    = *(shared->X_current);
+    const double *teleport  = shared->teleport;
+    const double jump       = pagerank_jump_scale(shared, true);
+
+    double my_error = 0.0;
+    double my_S_t   = 0.0;
+    double my_mass  = 0.0;
+
+    for(int i = start; i<end; i++){
+        X_curr[i] = pagerank_jump(teleport, jump, i) + (shared->dumping_factor * X_curr[i]);
+
+        //compute S_t for next iteration
+        if(g->out[i] == 0)
+            my_S_t += X_curr[i];
+
+        //compute error for next iteration
+        my_error += fabs(X_curr[i] - X_prev[i]);
+        my_mass  += X_curr[i];
+    }
+
+    acc->error  += my_error;
+    acc->S_t    += my_S_t;
+    acc->mass   += my_mass;
+    acc->active += end - start;
+}
+
+/**
+ * pagerank_gather()
+ * -----------------
+ * X phase over the nodes [start, end): the gather kernel
+ * sums the rank flowing through the in-edges into X_curr,
+ * then a sequential pass completes the update and
+ * accumulates the dead end mass and the L1 error of the range
+ */
+static inline void pagerank_gather(pagerank_shared_attr *shared, int start, int end, pagerank_partial *acc){
+    double *X_curr = *(shared->X_current);
+
+    if(shared->precision == PREC_MIXED)
+        pagerank_sum_f(shared, X_curr + start, start, end);
+    else
+        pagerank_sum(shared, X_curr + start, start, end);
+
+    pagerank_update(shared, start, end, acc);
+}
+
+/**
+ * pagerank_scatter()
+ * ------------------
+ * push X phase, first half: thread t writes the Y of its
+ * source range along the out-lists, into its bin of each
+ * destination range. The out-lists are sorted, so the bin
+ * of the next target is found moving forward from the
+ * first one. pagerank_push_setup() walks the edges the
+ * same way to store the targets of every slot
+ */
+static inline void pagerank_scatter(pagerank_shared_attr *shared, int t){
+    const graph *g      = shared->grph;
+    const int T         = shared->thread_count;
+    const int *dst      = shared->push_dst;
+    const double *Y     = shared->Y;
+    double *value       = shared->bin_value;
+    edge_t cursor[T];
+
+    for(int p = 0; p<T; p++)
+        cursor[p] = shared->bin_start[p * T + t];
+
+    for(int u = shared->push_src[t]; u<shared->push_src[t+1]; u++){
+        const double y = Y[u];
+        int p = 0;
+
+        for(edge_t j = g->out_offsets[u]; j<g->out_offsets[u+1]; j++){
+            while(g->targets[j] >= dst[p+1])
+                p++;
+            value[cursor[p]++] = y;
+        }
+    }
+}
+
+/**
+ * pagerank_push_sum()
+ * -------------------
+ * push X phase, second half: thread p adds up the bins of
+ * its destination range (contiguous, one per source range)
+ * into X_curr, then the same update of the pull version
+ */
+static inline void pagerank_push_sum(pagerank_shared_attr *shared, int p, pagerank_partial *acc){
+    const int T         = shared->thread_count;
+    const int start     = shared->push_dst[p];
+    const int end       = shared->push_dst[p+1];
+    const int *target   = shared->bin_target;
+    const double *value = shared->bin_value;
+    double *X_curr      = *(shared->X_current);
+
+    memset(X_curr + start, 0, (end - start) * sizeof(double));
+    for(edge_t j = shared->bin_start[p * T]; j<shared->bin_start[(p + 1) * T]; j++)
+        X_curr[target[j]] += value[j];
+
+    pagerank_update(shared, start, end, acc);
+}
+
+/**
+ * pagerank_push_setup()
+ * ---------------------
+ * parallel for body over the source ranges: with fill false
+ * counts the edges of each bin (in bin_start, shifted by
+ * one), with fill true stores the target of every slot and
+ * touches the value pages
+ */
+typedef struct push_setup_attr{
+    pagerank_shared_attr    *shared;
+    bool                    fill;
+}push_setup_attr;
+
+static void pagerank_push_setup_body(void *attr, int t_start, int t_end){
+    push_setup_attr *arg            = (push_setup_attr *)attr;
+    pagerank_shared_attr *shared    = arg->shared;
+    const graph *g                  = shared->grph;
+    const int T                     = shared->thread_count;
+    const int *dst                  = shared->push_dst;
+    edge_t cursor[T];
+
+    for(int t = t_start; t<t_end; t++){
+        for(int p = 0; p<T; p++)
+            cursor[p] = arg->fill ? shared->bin_start[p * T + t] : 0;
+
+        for(int u = shared->push_src[t]; u<shared->push_src[t+1]; u++){
+            int p = 0;
+
+            for(edge_t j = g->out_offsets[u]; j<g->out_offsets[u+1]; j++){
+                while(g->targets[j] >= dst[p+1])
+                    p++;
+                if(arg->fill){
+                    shared->bin_target[cursor[p]]  = g->targets[j];
+                    shared->bin_value[cursor[p]]   = 0.0;
+                }
+                cursor[p]++;
+            }
+        }
+
+        if(!arg->fill)
+            for(int p = 0; p<T; p++)
+                shared->bin_start[p * T + t + 1] = cursor[p];
+    }
+}
+
+static void pagerank_push_setup(pagerank_shared_attr *shared, thread_pool *pool){
+    graph *g    = shared->grph;
+    const int T = shared->thread_count;
+    push_setup_attr arg = {.shared = shared, .fill = false};
+
+    graph_build_out(g, pool);
+
+    shared->push_dst    = xmalloc((T + 1) * sizeof(int), HERE);
+    shared->push_src    = xmalloc((T + 1) * sizeof(int), HERE);
+    shared->bin_start   = xcalloc((size_t)T * T + 1, sizeof(edge_t), HERE);
+    shared->bin_target  = xmalloc((g->edges + 1) * sizeof(int), HERE);
+    shared->bin_value   = xmalloc((g->edges + 1) * sizeof(double), HERE);
+
+    graph_partition(g, T, shared->push_dst);
+
+    //smallest u with out_offsets[u] + u >= the share of range t
+    const long total = (long)g->edges + g->nodes;
+    shared->push_src[0] = 0;
+    shared->push_src[T] = g->nodes;
+    for(int t = 1; t<T; t++){
+        const long target = (total * t) / T;
+        int lo = shared->push_src[t-1];
+        int hi = g->nodes;
+
+        while(lo < hi){
+            int mid = lo + (hi - lo) / 2;
+            if((long)g->out_offsets[mid] + mid < target)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        shared->push_src[t] = lo;
+    }
+
+    pool_parallel_for(pool, 0, T, 1, pagerank_push_setup_body, &arg);
+    for(int b = 0; b<T * T; b++)
+        shared->bin_start[b+1] += shared->bin_start[b];
+
+    arg.fill = true;
+    pool_parallel_for(pool, 0, T, 1, pagerank_push_setup_body, &arg);
+}
+
+/**
+ * pagerank_gather_adaptive()
+ * --------------------------
+ * pagerank_gather() skipping the in-edge sums of the frozen
+ * nodes: the gather kernel runs on each run of consecutive
+ * active nodes. frozen[i] counts the iterations in a row
+ * in which d * (change of the sum) stayed below adapt_tol
+ * times the rank, at ADAPT_STREAK the node is frozen. Only
+ * the sum is frozen: adapt_sums keeps the last one and the
+ * jump term (teleport and S_t, the same for every node) is
+ * still added at every iteration, O(1) per node. Freezing
+ * the whole rank would leave the nodes behind the global
+ * S_t, which moves every rank at the same rate.
+ *
+ * The error of an iteration misses the change of the frozen
+ * sums: a full iteration (adapt_full) recomputes every sum
+ * and gives the true one. It runs when the error drops
+ * below epsilon and at least every ADAPT_CHECK iterations,
+ * and only a full iteration can end the run. It keeps the
+ * counters: the nodes whose sum moved go back to the active
+ * set, the others stay frozen. Every full iteration that
+ * does not end the run divides adapt_tol by 10, so a loose
+ * threshold can't keep stale sums until the end
+ */
+static inline void pagerank_gather_adaptive(pagerank_shared_attr *shared, int start, int end, pagerank_partial *acc){
+    const graph  *g         = shared->grph;
+    const double *X_prev    = *(shared->X_previous);
+    double       *X_curr    = *(shared->X_current);
+    double       *sums      = shared->adapt_sums;
+    unsigned char *frozen   = shared->frozen;
+    const bool   full       = shared->adapt_full;
+    const double d          = shared->dumping_factor;
+    const double tol        = shared->adapt_tol;
+    const double *teleport  = shared->teleport;
+    const double jump       = pagerank_jump_scale(shared, true);
+
+    double my_error = 0.0;
+    double my_S_t   = 0.0;
+    double my_mass  = 0.0;
+    long my_active  = 0;
+    long my_edges   = 0;
+
+    int i = start;
+    while(i < end){
+        if(!full && frozen[i] == ADAPT_STREAK){
+            X_curr[i] = pagerank_jump(teleport, jump, i) + (d * sums[i]);
+
+            if(g->out[i] == 0)
+                my_S_t += X_curr[i];
+            my_error += fabs(X_curr[i] - X_prev[i]);
+            my_mass  += X_curr[i];
+            i++;
+            continue;
+        }
+
+        //run of active nodes [i, run_end)
+        const int run_start = i;
+        int run_end = i + 1;
+        while(run_end < end && (full || frozen[run_end] < ADAPT_STREAK))
+            run_end++;
+
+        if(shared->precision == PREC_MIXED)
+            pagerank_sum_f(shared, X_curr + i, i, run_end);
+        else
+            pagerank_sum(shared, X_curr + i, i, run_end);
+
+        for(; i<run_end; i++){
+            const double sum = X_curr[i];
+            const bool still = (d * fabs(sum - sums[i]) < tol * X_prev[i]);
+
+            sums[i]   = sum;
+            X_curr[i] = pagerank_jump(teleport, jump, i) + (d * sum);
+
+            if(g->out[i] == 0)
+                my_S_t += X_curr[i];
+
+            my_error += fabs(X_curr[i] - X_prev[i]);
+            my_mass  += X_curr[i];
+
+            if(!still)
+                frozen[i] = 0;
+            else if(frozen[i] < ADAPT_STREAK)
+                frozen[i] += 1;
+        }
+
+        my_active += run_end - run_start;
+        my_edges  += g->offsets[run_end] - g->offsets[run_start];
+    }
+
+    acc->error      += my_error;
+    acc->S_t        += my_S_t;
+    acc->mass       += my_mass;
+    acc->active     += my_active;
+    acc->gathered   += my_edges;
+}
+
+/**
+ * pagerank_gather_f()
+ * -------------------
+ * pagerank_gather() for float rank vectors: the sums of a
+ * block of GATHER_BLOCK nodes are kept in double on the
+ * stack, the update is done in double and rounded on store
+ */
+static inline void pagerank_gather_f(pagerank_shared_attr *shared, int start, int end, pagerank_partial *acc){
+    const graph  *g         = shared->grph;
+    const float  *X_prev    = *(shared->Xf_previous);
+    float        *X_curr    = *(shared->Xf_current);
+    const double *teleport  = shared->teleport;
+    const double jump       = pagerank_jump_scale(shared, true);
+    double sums[GATHER_BLOCK];
+
+    double my_error = 0.0;
+    double my_S_t   = 0.0;
+    double my_mass  = 0.0;
+
+    for(int b = start; b<end; b += GATHER_BLOCK){
+        const int b_end = (end - b > GATHER_BLOCK) ? b + GATHER_BLOCK : end;
+
+        pagerank_sum_f(shared, sums, b, b_end);
+
+        for(int i = b; i<b_end; i++){
+            const double x = pagerank_jump(teleport, jump, i) + (shared->dumping_factor * sums[i - b]);
+            X_curr[i] = (float)x;
+
+            if(g->out[i] == 0)
+                my_S_t += x;
+
+            my_error += fabs((double)X_curr[i] - (double)X_prev[i]);
+            my_mass  += x;
+        }
+    }
+
+    acc->error  += my_error;
+    acc->S_t    += my_S_t;
+    acc->mass   += my_mass;
+    acc->active += end - start;
+}
+
+//racy Y of the sweep: __atomic_*_n take integers only
+static inline double relaxed_load(const double *p){
+    double v;
+    __atomic_load(p, &v, __ATOMIC_RELAXED);
+    return v;
+}
+
+static inline void relaxed_store(double *p, double v){
+    __atomic_store(p, &v, __ATOMIC_RELAXED);
+}
+
+/**
+ * pagerank_sweep()
+ * ----------------
+ * Gauss-Seidel X phase over the nodes [start, end): each
+ * node is updated in place and its contribution Y[i] is
+ * refreshed at once, so the following nodes of the range
+ * already read it. Nodes of other threads are read with
+ * the value of this sweep or of the previous one: Y is
+ * read and written concurrently on purpose, with relaxed
+ * atomic loads and stores (plain moves on x86) so that the
+ * race is defined behavior and any value seen is a whole
+ * one.
+ *
+ * The sweep solves the linear system without the dead end
+ * term, x = (1-d) v + d * A x: its solution scaled to sum 1
+ * is the pagerank vector (the dead end mass is spread on
+ * the teleport vector v too, so it only changes the
+ * scale). In place updates don't keep the sum at 1 anyway,
+ * and the rank-one dead end term computed from a stale S_t
+ * makes the in place iteration unstable. The error is
+ * relative to the mass, the vector is normalized at the end
+ */
+static inline void pagerank_sweep(pagerank_shared_attr *shared, int start, int end, pagerank_partial *acc){
+    const graph  *g         = shared->grph;
+    const edge_t *offsets   = g->offsets;
+    const int    *sources   = g->sources;
+    const double *inv_out   = shared->inv_out;
+    double       *X         = *(shared->X_current);
+    double       *Y         = shared->Y;
+    const double *teleport  = shared->teleport;
+    const double jump       = pagerank_jump_scale(shared, false);
+
+    double my_error = 0.0;
+    double my_S_t   = 0.0;
+    double my_mass  = 0.0;
+
+    for(int i = start; i<end; i++){
+        double sum = 0.0;
+        const edge_t in_end = offsets[i+1];
+
+        for(edge_t j = offsets[i]; j<in_end; j++)
+            sum += relaxed_load(&Y[sources[j]]);
+
+        const double x = pagerank_jump(teleport, jump, i) + (shared->dumping_factor * sum);
+
+        my_error   += fabs(x - X[i]);
+        my_mass    += x;
+        X[i]        = x;
+        relaxed_store(&Y[i], x * inv_out[i]);
+
+        if(g->out[i] == 0)
+            my_S_t += x;
+    }
+
+    acc->error  += my_error;
+    acc->S_t    += my_S_t;
+    acc->mass   += my_mass;
+    acc->active += end - start;
+}
+
+/**
+ * pagerank_contrib()
+ * ------------------
+ * Y phase over the nodes [start, end). inv_out is 0 for
+ * dead ends: no branch, the loops vectorize
+ */
+static inline void pagerank_contrib(pagerank_shared_attr *shared, int start, int end){
+    const double *inv_out = shared->inv_out;
+
+    switch(shared->precision){
+        case PREC_FLOAT:{
+            const float *X_prev = *(shared->Xf_previous);
+            for(int i = start; i<end; i++)
+                shared->Yf[i] = (float)(X_prev[i] * inv_out[i]);
+        }
+        break;
+        case PREC_MIXED:{
+            const double *X_prev = *(shared->X_previous);
+            for(int i = start; i<end; i++)
+                shared->Yf[i] = (float)(X_prev[i] * inv_out[i]);
+        }
+        break;
+        default:{
+            const double *X_prev = *(shared->X_previous);
+            for(int i = start; i<end; i++)
+                shared->Y[i] = X_prev[i] * inv_out[i];
+        }
+    }
+}
+
+/**
+ * pagerank_record()
+ * -----------------
+ * keeps the iterates needed by the next extrapolation:
+ * at the top of iteration t X_previous holds x(t), it is
+ * copied in the ring if t is 2 (or 3, quadratic) iterations
+ * before the next extrapolation
+ */
+static inline void pagerank_record(pagerank_shared_attr *shared, int start, int end){
+    const int t = shared->iteration;
+    const double *X_prev = *(shared->X_previous);
+
+    if((t + 2) % EXTRAP_PERIOD == 0)
+        memcpy(shared->history[0] + start, X_prev + start, (end - start) * sizeof(double));
+    if(shared->extrapolate == EXTRAP_QUADRATIC && (t + 3) % EXTRAP_PERIOD == 0)
+        memcpy(shared->history[1] + start, X_prev + start, (end - start) * sizeof(double));
+}
+
+/**
+ * pagerank_extrapolate()
+ * ----------------------
+ * replaces x(t) (X_previous) with the extrapolated vector
+ * on the thread Y range, then rescales it to sum 1 (and
+ * recomputes S_t) before the Y phase. x(t-1) is still in
+ * X_current, x(t-2) and x(t-3) in the ring.
+ *
+ * Quadratic: y_j = x(t-3+j) - x(t-3), the gammas solve the
+ * least squares [y1 y2] g = -y3 (g3 = 1, the products are
+ * reduced at a barrier) and
+ *      x* = (g1+g2+g3) x(t-2) + (g2+g3) x(t-1) + g3 x(t)
+ * Aitken, componentwise on x(t-2), x(t-1), x(t):
+ *      x* = x(t) - (x(t) - x(t-1))^2 / (x(t) - 2 x(t-1) + x(t-2))
+ * a component is left as is when the correction is not
+ * smaller than the value itself. x(t) is saved over x(t-2),
+ * no longer needed, in case the step gets rejected (Aitken
+ * only, see EXTRAP_AITKEN)
+ */
+static void pagerank_extrapolate(pagerank_thread_attr *arg, int *sense){
+    pagerank_shared_attr *shared    = arg->shared;
+    pagerank_partial     *partial   = &(shared->partial[arg->id]);
+    const int start     = arg->interval_start;
+    const int end       = arg->interval_end;
+    const int *out      = shared->grph->out;
+    double       *x2    = *(shared->X_previous);
+    const double *x1    = *(shared->X_current);
+    double       *x0    = shared->history[0];
+
+    if(shared->extrapolate == EXTRAP_QUADRATIC){
+        const double *xm = shared->history[1];
+        double dot[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+
+        for(int i = start; i<end; i++){
+            const double y1 = x0[i] - xm[i];
+            const double y2 = x1[i] - xm[i];
+            const double y3 = x2[i] - xm[i];
+            dot[0] += y1 * y1;
+            dot[1] += y1 * y2;
+            dot[2] += y2 * y2;
+            dot[3] += y1 * y3;
+            dot[4] += y2 * y3;
+        }
+        memcpy(partial->dot, dot, sizeof(dot));
+
+        if(barrier_enter(shared->barrier, sense)){
+            double a[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+            for(int t = 0; t<shared->thread_count; t++)
+                for(int j = 0; j<5; j++)
+                    a[j] += shared->partial[t].dot[j];
+
+            const double det = a[0] * a[2] - a[1] * a[1];
+            double g1 = 0.0, g2 = 0.0;
+
+            //singular (iterates already aligned): no extrapolation
+            if(fabs(det) > 1e-12 * a[0] * a[2] && det != 0.0){
+                g1 = (-a[3] * a[2] + a[1] * a[4]) / det;
+                g2 = (-a[0] * a[4] + a[1] * a[3]) / det;
+            }
+            shared->extrap_coef[0] = g1 + g2 + 1.0;
+            shared->extrap_coef[1] = g2 + 1.0;
+            shared->extrap_coef[2] = 1.0;
+
+            barrier_release(shared->barrier, sense);
+        }
+
+        const double b0 = shared->extrap_coef[0];
+        const double b1 = shared->extrap_coef[1];
+        const double b2 = shared->extrap_coef[2];
+
+        for(int i = start; i<end; i++){
+            const double x = b0 * x0[i] + b1 * x1[i] + b2 * x2[i];
+            x2[i] = (x > 0.0) ? x : 0.0;
+        }
+    }
+    else{
+        for(int i = start; i<end; i++){
+            const double d = x2[i] - x1[i];
+            const double h = x2[i] - 2.0 * x1[i] + x0[i];
+
+            x0[i] = x2[i];
+            if(h != 0.0){
+                const double corr = d * d / h;
+                if(fabs(corr) < x2[i])
+                    x2[i] -= corr;
+            }
+        }
+    }
+
+    double mass = 0.0, dead = 0.0;
+    for(int i = start; i<end; i++){
+        mass += x2[i];
+        if(out[i] == 0)
+            dead += x2[i];
+    }
+    partial->mass   = mass;
+    partial->S_t    = dead;
+
+    if(barrier_enter(shared->barrier, sense)){
+        double mass_all = 0.0, dead_all = 0.0;
+        for(int t = 0; t<shared->thread_count; t++){
+            mass_all += shared->partial[t].mass;
+            dead_all += shared->partial[t].S_t;
+        }
+
+        shared->extrap_error    = shared->error;
+        shared->extrap_S_t      = shared->S_t;
+        shared->extrap_pending  = (shared->extrapolate == EXTRAP_AITKEN);
+        shared->extrap_scale    = 1.0 / mass_all;
+        shared->S_t             = dead_all / mass_all;
+        shared->extrapolations += 1;
+
+        barrier_release(shared->barrier, sense);
+    }
+
+    const double scale = shared->extrap_scale;
+    for(int i = start; i<end; i++)
+        x2[i] *= scale;
+}
+
+static inline double monotonic_time(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * pagerank_perf_sample()
+ * ----------------------
+ * counters and wall time of the calling thread since
+ * (c_start, t_start), stored as the given phase (0 = Y,
+ * 1 = X) of iteration `it`
+ */
+static void pagerank_perf_sample(pagerank_shared_attr *shared, const perf_thread *counters, int id, int it, int phase, const perf_values *c_start, double t_start){
+    if(it >= shared->perf_iter)
+        return;
+
+    perf_sample *sample = &(shared->perf_log[((size_t)id * shared->perf_iter + it) * 2 + phase]);
+    perf_values c_end;
+
+    perf_read(counters, &c_end);
+    sample->time = monotonic_time() - t_start;
+    perf_delta(c_start, &c_end, &(sample->c));
+}
+
+/**
+ * pagerank_metrics_emit()
+ * -----------------------
+ * JSON line of iteration `it` (0-based) on shared->metrics.
+ * The wall time of a phase is the longest busy + wait time
+ * over the threads
+ */
+static void pagerank_metrics_emit(pagerank_shared_attr *shared, int it){
+    const pagerank_metrics *m = shared->metrics_log;
+    const int slot = it % 2;
+    double y_time = 0.0;
+    double x_time = 0.0;
+    long edges = 0;
+
+    for(int t = 0; t<shared->thread_count; t++){
+        const pagerank_metrics *tm = &m[t * 2 + slot];
+        if(tm->y_busy + tm->y_wait > y_time)
+            y_time = tm->y_busy + tm->y_wait;
+        if(tm->x_busy + tm->x_wait > x_time)
+            x_time = tm->x_busy + tm->x_wait;
+        edges += tm->edges;
+    }
+
+    fprintf(shared->metrics, "{\"iteration\":%d,\"error\":%.9e,\"S_t\":%.9e,\"y_time\":%.9f,\"x_time\":%.9f,\"edges\":%ld,\"edges_per_sec\":%.0f",
+        it + 1, shared->metrics_error[slot], shared->metrics_S_t[slot], y_time, x_time, edges,
+        (y_time + x_time > 0.0) ? (double)edges / (y_time + x_time) : 0.0);
+
+    fprintf(shared->metrics, ",\"wait_y\":[");
+    for(int t = 0; t<shared->thread_count; t++)
+        fprintf(shared->metrics, "%s%.9f", (t > 0) ? "," : "", m[t * 2 + slot].y_wait);
+    fprintf(shared->metrics, "],\"wait_x\":[");
+    for(int t = 0; t<shared->thread_count; t++)
+        fprintf(shared->metrics, "%s%.9f", (t > 0) ? "," : "", m[t * 2 + slot].x_wait);
+    fprintf(shared->metrics, "]}\n");
+    fflush(shared->metrics);
+}
+
 void *pagerank_routine(void *attr){
     pagerank_thread_attr *arg = (pagerank_thread_attr *)attr;
     pagerank_shared_attr *shared = arg->shared;
-    const double teleport = (1.0 - shared->dumping_factor) / ((double)(shared->grph->nodes));
-    double my_S_t;
-    double my_error;
+    const int *bounds = shared->bounds;
+    pagerank_partial *partial = &(shared->partial[arg->id]);
+    pagerank_partial acc;
+    int sense = 0;
+    long my_nodes   = 0;
+    long my_edges   = 0;
+    double my_busy  = 0.0;
+    double x_start  = 0.0;
+
+    //counters of this thread (--perf)
+    const perf_thread *counters = (shared->perf_log != NULL) ? perf_self(perf) : NULL;
+    perf_values c_start;
+    double t_start  = 0.0;
+    int it          = 0;
+
+    //timings of this thread (--metrics)
+    pagerank_metrics *m = NULL;
+    double t_mark   = 0.0;
+    long it_edges   = 0;
     
-    //swap variable for vectors;
+    void (*gather)(pagerank_shared_attr *, int, int, pagerank_partial *);
+
+    if(shared->solver == SOLVER_GS)
+        gather = pagerank_sweep;
+    else if(shared->frozen != NULL)
+        gather = pagerank_gather_adaptive;
+    else if(shared->precision == PREC_FLOAT)
+        gather = pagerank_gather_f;
+    else
+        gather = pagerank_gather;
+
+    //swap variables for vectors;
     double *temp;
+    float *temp_f;
     do{
-        // === Computation of Y components ===
-        for(int i = arg->interval_start; i<=arg->interval_end; i++){
-            if(shared->grph->out[i] > 0)
-                shared->Y[i] = ((*(shared->X_previous))[i]) / ((double)(shared->grph->out)[i]);
+        it = shared->iteration;
+        if(shared->metrics_log != NULL){
+            m = &(shared->metrics_log[arg->id * 2 + it % 2]);
+            m->y_busy   = 0.0;
+            m->y_wait   = 0.0;
+            m->x_busy   = 0.0;
+            m->x_wait   = 0.0;
+            it_edges    = my_edges;
+            t_mark      = monotonic_time();
+        }
+        if(counters != NULL){
+            t_start = monotonic_time();
+            perf_read(counters, &c_start);
         }
 
-        // === Thread suspension ===
-        xpthread_mutex_lock(shared->cond_mux, HERE);
-            if((shared->waiting_on_Y) == (shared->thread_count - 1)){
-                shared->do_X = true;
-                shared->do_Y = false;
-                xpthread_cond_broadcast(shared->cond, HERE);
-            } 
-            else {
-                shared->waiting_on_Y += 1;
-                    while (shared->do_X == false)
-                        xpthread_cond_wait(shared->cond, shared->cond_mux, HERE);  
-                shared->waiting_on_Y -= 1;
+        /**
+         * === Computation of Y components ===
+         * (Gauss-Seidel keeps Y up to date in the sweep)
+         */
+        if(shared->solver == SOLVER_JACOBI){
+            if(shared->extrapolate != EXTRAP_NONE){
+                if(shared->extrap_restore)
+                    memcpy(*(shared->X_previous) + arg->interval_start, shared->history[0] + arg->interval_start,
+                        (arg->interval_end - arg->interval_start) * sizeof(double));
+                if(shared->iteration > 0 && shared->iteration % EXTRAP_PERIOD == 0 && shared->extrap_rejected == 0)
+                    pagerank_extrapolate(arg, &sense);
+                pagerank_record(shared, arg->interval_start, arg->interval_end);
+            }
+
+            pagerank_contrib(shared, arg->interval_start, arg->interval_end);
+
+            if(counters != NULL)
+                pagerank_perf_sample(shared, counters, arg->id, it, 0, &c_start, t_start);
+
+            if(m != NULL){
+                const double now = monotonic_time();
+                m->y_busy   = now - t_mark;
+                t_mark      = now;
             }
-        xpthread_mutex_unlock(shared->cond_mux, HERE);
+
+            // === Thread suspension ===
+            barrier_wait(shared->barrier, &sense);
+
+            if(m != NULL){
+                const double now = monotonic_time();
+                m->y_wait   = now - t_mark;
+                t_mark      = now;
+            }
+
+            if(counters != NULL){
+                t_start = monotonic_time();
+                perf_read(counters, &c_start);
+            }
+        }
 
         // === Computation of X components ===
 
-        my_error    = 0.0;
-        my_S_t      = 0.0;
+        acc.error   = 0.0;
+        acc.S_t     = 0.0;
+        acc.mass    = 0.0;
+        acc.active  = 0;
+        acc.gathered= 0;
+
+        if(shared->timed)
+            x_start = monotonic_time();
+
+        if(shared->push){
+            const int p = arg->id;
+
+            pagerank_scatter(shared, p);
+            barrier_wait(shared->barrier, &sense);
+            pagerank_push_sum(shared, p, &acc);
+            my_nodes += shared->push_dst[p+1] - shared->push_dst[p];
+            my_edges += shared->bin_start[(p + 1) * shared->thread_count] - shared->bin_start[p * shared->thread_count];
+        }
+        else if(shared->schedule == SCHED_DYNAMIC){
+            int c;
+            while((c = __atomic_fetch_add(&(shared->next_chunk), 1, __ATOMIC_RELAXED)) < shared->chunk_count){
+                gather(shared, bounds[c], bounds[c+1], &acc);
+                my_nodes += bounds[c+1] - bounds[c];
+                my_edges += shared->grph->offsets[bounds[c+1]] - shared->grph->offsets[bounds[c]];
+            }
+        }
+        else{
+            gather(shared, bounds[arg->id], bounds[arg->id+1], &acc);
+            my_nodes += bounds[arg->id+1] - bounds[arg->id];
+            my_edges += shared->grph->offsets[bounds[arg->id+1]] - shared->grph->offsets[bounds[arg->id]];
+        }
 
-        for(int i = arg->interval_start; i<=arg->interval_end; i++){
-            double sum_dead_end = 0.0;
-            inmap *obj = ((shared->grph)->in)[i];
-            
-            if(obj != NULL){
-                for(int i = 0; i < obj->length; i++)
-                    sum_dead_end += (shared->Y)[(obj->vector[i])];
-            }     
-            (*(shared->X_current))[i] = teleport + (shared->dumping_factor * sum_dead_end) + (shared->dumping_factor / (double)(shared->grph->nodes)) * shared->S_t;  
+        if(shared->timed)
+            my_busy += monotonic_time() - x_start;
 
-            //compute S_t for next iteration
-            if(shared->grph->out[i] == 0)
-                my_S_t += ((*(shared->X_current))[i]);
+        if(counters != NULL)
+            pagerank_perf_sample(shared, counters, arg->id, it, 1, &c_start, t_start);
 
-            //compute error for next iteration
-            my_error += fabs((*(shared->X_current))[i] - (*(shared->X_previous))[i]);
+        if(m != NULL){
+            const double now = monotonic_time();
+            m->x_busy   = now - t_mark;
+            m->edges    = my_edges - it_edges;
+            t_mark      = now;
         }
+
+        /**
+         * Dump error and S_t in the thread own slot
+         * (padded: no false sharing, no lock)
+         */
+        partial->error  = acc.error;
+        partial->S_t    = acc.S_t;
+        partial->mass   = acc.mass;
+        partial->active = acc.active;
+        partial->gathered = acc.gathered;
         
         // === Thread suspension ===
-        xpthread_mutex_lock(shared->cond_mux, HERE);
+        if(barrier_enter(shared->barrier, &sense)){
+            if(m != NULL)
+                m->x_wait = monotonic_time() - t_mark;
+
+            /**
+             * Serial section (last thread to arrive)
+             * 1. Reduce error and S_t over the threads slots
+             *
+             * 2. If error less than threshold (epsilon) exit
+             */
+            double error    = 0.0;
+            double S_t      = 0.0;
+            double mass     = 0.0;
+            long active     = 0;
+            long gathered   = 0;
+            for(int t = 0; t<shared->thread_count; t++){
+                error  += shared->partial[t].error;
+                S_t    += shared->partial[t].S_t;
+                mass   += shared->partial[t].mass;
+                active += shared->partial[t].active;
+                gathered += shared->partial[t].gathered;
+            }
+
+            //Gauss-Seidel: the vector is not normalized
+            if(shared->solver == SOLVER_GS)
+                error /= mass;
+
+            bool converged = (error < shared->epsilon);
+
+            //adaptive: only a full iteration can end the run
+            if(shared->frozen != NULL){
+                if(shared->adapt_full){
+                    //not done yet: the next nodes freeze closer to convergence
+                    if(!converged)
+                        shared->adapt_tol  *= 0.1;
+                    shared->adapt_full      = false;
+                    shared->adapt_since     = 0;
+                    shared->adapt_checks   += 1;
+                }
+                else{
+                    shared->adapt_since    += 1;
+                    shared->adapt_full      = converged || (active == 0) || (shared->adapt_since >= ADAPT_CHECK);
+                    converged               = false;
+                }
+            }
+
             /**
-             * Dump shared error and S_t for next iteration
+             * Aitken safeguard: the residual has to drop after
+             * the step, otherwise the next iteration goes back
+             * to the replaced iterate and its S_t, and no more
+             * steps are taken
              */
-            shared->error       += my_error;
-            shared->S_t_shared  += my_S_t;
-
-            if((shared->waiting_on_X) == (shared->thread_count - 1)){
-                /**
-                 * 1. If error more than threshold (epsilon) exit
-                 * 
-                 * 2. Swap local S_t with global S_t
-                 */
-                if((shared->error < shared->epsilon) || (*(shared->curr_iter) == (shared->max_iter - 1)))
-                    shared->exit = true;
-                
-                shared->error       = 0;              
-                shared->S_t         = shared->S_t_shared;
-                shared->S_t_shared  = 0.0;
-                
-                xpthread_mutex_lock(shared->shared_mux, HERE);
+            shared->extrap_restore = false;
+            if(shared->extrap_pending){
+                shared->extrap_pending = false;
+                if(error >= shared->extrap_error){
+                    shared->extrap_restore      = true;
+                    shared->extrapolations     -= 1;
+                    shared->extrap_rejected    += 1;
+                    S_t                         = shared->extrap_S_t;
+                }
+            }
+
+            if(converged || (*(shared->curr_iter) == (shared->max_iter - 1)))
+                shared->exit = true;
+
+            /**
+             * auto direction: the first iteration warms up the
+             * vectors, the second one pushes, the third one
+             * pulls, then the faster one is kept until the end
+             */
+            if(shared->direction == DIR_AUTO && it < 3){
+                const double now = monotonic_time();
+
+                if(it > 0)
+                    shared->probe_time[shared->push ? 1 : 0] = now - shared->probe_mark;
+                shared->probe_mark  = now;
+                shared->push        = (it == 0) || (it == 2 && shared->probe_time[1] < shared->probe_time[0]);
+
+                if(it == 2 && !shared->push){
+                    free(shared->bin_target);
+                    free(shared->bin_value);
+                    shared->bin_target  = NULL;
+                    shared->bin_value   = NULL;
+                }
+            }
+
+            shared->S_t = S_t;
+            shared->error = error;
+            shared->mass = mass;
+            if(shared->log_len < shared->max_iter)
+                shared->active_log[shared->log_len++] = active;
+            shared->adapt_edges += gathered;
+
+            //the previous iteration is complete on every thread
+            if(shared->metrics_log != NULL){
+                shared->metrics_error[it % 2]   = error;
+                shared->metrics_S_t[it % 2]     = S_t;
+                if(it > 0)
+                    pagerank_metrics_emit(shared, it - 1);
+            }
+            shared->next_chunk = 0;
+
+            xpthread_mutex_lock(shared->shared_mux, HERE);
 
+                if(shared->solver == SOLVER_GS){
+                    /**
+                     * one vector, nothing to swap: X_previous
+                     * only aliases it for the signal handler
+                     */
+                    if(shared->exit == true)
+                        *(shared->X_previous) = NULL;
+                }
+                else if(shared->precision == PREC_FLOAT){
+                    temp_f = *(shared->Xf_previous);
+                    *(shared->Xf_previous) = *(shared->Xf_current);
+                    *(shared->Xf_current) = temp_f;
+                }
+                else{
                     temp = *(shared->X_previous);
                     *(shared->X_previous) = *(shared->X_current);
                     *(shared->X_current) = temp;
+                }
 
-                    if(shared->exit == true){
-                        /**
-                         * Setting previous vector as null
-                         * for the signal handler
-                         */
-                        free(*(shared->X_previous));
-                        *(shared->X_previous) = NULL;
-                    }
+                if(shared->exit == true && shared->solver == SOLVER_JACOBI){
+                    /**
+                     * Setting previous vector as null
+                     * for the signal handler
+                     */
+                    free(*(shared->X_previous));
+                    *(shared->X_previous) = NULL;
+                    free(*(shared->Xf_previous));
+                    *(shared->Xf_previous) = NULL;
+                }
 
-                    *(shared->curr_iter) += 1;
+                *(shared->curr_iter) += 1;
+                shared->iteration    += 1;
 
-                xpthread_mutex_unlock(shared->shared_mux, HERE);
-                shared->do_Y = true;
-                shared->do_X = false;
-                xpthread_cond_broadcast(shared->cond, HERE);
-            }
-            else {
-                shared->waiting_on_X += 1;
+            xpthread_mutex_unlock(shared->shared_mux, HERE);
 
-                while(shared->do_Y == false)
-                    xpthread_cond_wait(shared->cond, shared->cond_mux , HERE);
+            barrier_release(shared->barrier, &sense);
+        }
+        else if(m != NULL)
+            m->x_wait = monotonic_time() - t_mark;
 
-                shared->waiting_on_X -= 1;
-            }
+    } while(shared->exit == false);
 
-        xpthread_mutex_unlock(shared->cond_mux, HERE);
+    arg->nodes  = my_nodes;
+    arg->edges  = my_edges;
+    arg->busy   = my_busy;
 
-    } while(shared->exit == false);
+    return NULL;
+}
 
-    pthread_exit(NULL);
+/**
+ * pagerank_init_body()
+ * --------------------
+ * parallel for body: init of both iteration vectors (uniform,
+ * or the warm start vector) and the reciprocals of the
+ * out-degrees used by the Y phase
+ */
+void pagerank_init_body(void *attr, int start, int end){
+    pagerank_shared_attr *shared = (pagerank_shared_attr *)attr;
+    const double uniform = 1.0 / (double)(shared->grph->nodes);
+    const double *warm = shared->init;
+    const int *out = shared->grph->out;
+
+    if(shared->precision == PREC_FLOAT){
+        for(int i = start; i < end; i++){
+            const float init = (float)((warm != NULL) ? warm[i] : uniform);
+            (*(shared->Xf_current))[i]  = init;
+            (*(shared->Xf_previous))[i] = init;
+        }
+    }
+    else{
+        for(int i = start; i < end; i++){
+            const double init = (warm != NULL) ? warm[i] : uniform;
+            (*(shared->X_current))[i]   = init;
+            (*(shared->X_previous))[i]  = init;
+        }
+    }
+
+    for(int i = start; i < end; i++)
+        shared->inv_out[i] = (out[i] > 0) ? 1.0 / (double)out[i] : 0.0;
+
+    //Gauss-Seidel has no Y phase: first contributions here
+    if(shared->solver == SOLVER_GS)
+        for(int i = start; i < end; i++)
+            shared->Y[i] = ((warm != NULL) ? warm[i] : uniform) * shared->inv_out[i];
+}
+
+/**
+ * pagerank_report()
+ * -----------------
+ * per-thread load of the X phase over the whole run:
+ * nodes updated, in-edges gathered and busy time, then
+ * the imbalance as max / mean (1.00 is a perfect split)
+ * of the work (nodes + edges, what graph_partition
+ * balances) and of the busy time
+ */
+static void pagerank_report(FILE *stream, pagerank_thread_attr *thread_attr, int thread_count, int schedule, int kernel, int iter_count){
+    static const char *names[] = {"edges", "nodes", "dynamic"};
+    long   max_work  = 0, sum_work  = 0;
+    double max_busy  = 0.0, sum_busy = 0.0;
+
+    fprintf(stream, "--------------------\nX phase load: schedule %s, kernel %s, %d iterations\n--------------------\n", names[schedule], gather_name(kernel), iter_count);
+    fprintf(stream, "thread\tnodes\t\tedges\t\tbusy (sec)\n");
+    for(int i = 0; i<thread_count; i++){
+        const long work = thread_attr[i].nodes + thread_attr[i].edges;
+
+        fprintf(stream, "%d\t%-12ld\t%-12ld\t%.6f\n", i, thread_attr[i].nodes, thread_attr[i].edges, thread_attr[i].busy);
+        sum_work  += work;
+        sum_busy  += thread_attr[i].busy;
+        if(work > max_work)                     max_work    = work;
+        if(thread_attr[i].busy  > max_busy)     max_busy    = thread_attr[i].busy;
+    }
+
+    fprintf(stream, "imbalance\twork %.2f\tbusy %.2f\n",
+        (sum_work > 0) ? (double)max_work * thread_count / (double)sum_work : 1.0,
+        (sum_busy  > 0) ? max_busy * thread_count / sum_busy : 1.0);
 }
 
-double *pagerank(graph *grph, double dumping, double eps, int max_iter, int thread_count, int *iter_count){
+/**
+ * pagerank_adaptive_report()
+ * --------------------------
+ * active set size of each iteration, and the node updates
+ * of the whole run (full iterations included)
+ */
+static void pagerank_adaptive_report(FILE *stream, const long *active_log, int iterations, const graph *g, int checks, long edges){
+    const int nodes = g->nodes;
+    long total = 0;
+
+    fprintf(stream, "--------------------\nAdaptive: active nodes per iteration\n--------------------\n");
+    for(int i = 0; i<iterations; i++){
+        fprintf(stream, "%d\t%ld\t%.1f%%\n", i + 1, active_log[i], 100.0 * active_log[i] / (double)nodes);
+        total += active_log[i];
+    }
+
+    fprintf(stream, "recomputed\t%ld node updates (%.1f full iterations), %ld in-edges (%.1f), %d full checks\n",
+        total, (double)total / nodes, edges, (g->edges > 0) ? (double)edges / g->edges : 0.0, checks);
+}
+
+double *pagerank(graph *grph, double dumping, double eps, int max_iter, thread_pool *pool, pagerank_opts *opts, int *iter_count){
+
+    const int thread_count = pool->size;
+    const int schedule     = (opts != NULL) ? opts->schedule : SCHED_EDGES;
+    const int solver       = (opts != NULL) ? opts->solver : SOLVER_JACOBI;
+    const int precision    = (solver == SOLVER_GS) ? PREC_DOUBLE : ((opts != NULL) ? opts->precision : PREC_DOUBLE);
+    int kernel;
      
-    // iteration vectors allocation
-    double *X_current   = xmalloc(grph->nodes * sizeof(double), HERE);
-            X_previous  = xmalloc(grph->nodes * sizeof(double), HERE);
-    double *Y           = xcalloc(grph->nodes , sizeof(double), HERE);
+    /**
+     * iteration vectors allocation, only the ones of
+     * the selected precision (the others stay NULL)
+     */
+    double *X_current   = NULL;
+    float  *Xf_current  = NULL;
+    double *Y           = NULL;
+    float  *Yf          = NULL;
+            X_previous  = NULL;
+            Xf_previous = NULL;
+
+    if(precision == PREC_FLOAT){
+        Xf_current  = xmalloc(grph->nodes * sizeof(float), HERE);
+        Xf_previous = xmalloc(grph->nodes * sizeof(float), HERE);
+    }
+    else if(solver == SOLVER_GS){
+        X_current   = xmalloc(grph->nodes * sizeof(double), HERE);
+        X_previous  = X_current;
+    }
+    else{
+        X_current   = xmalloc(grph->nodes * sizeof(double), HERE);
+        X_previous  = xmalloc(grph->nodes * sizeof(double), HERE);
+    }
+
+    if(precision == PREC_DOUBLE)
+        Y   = xcalloc(grph->nodes , sizeof(double), HERE);
+    else
+        Yf  = xcalloc(grph->nodes , sizeof(float), HERE);
+
+    double *inv_out     = xmalloc(grph->nodes * sizeof(double), HERE);
 
-    // popolamento vettori iterazioni
     const double init = 1.0 /(double)grph->nodes;
-    for(int i = 0; i < grph->nodes; i++){
-        X_current [i]   = init;
-        X_previous[i]   = init;
-    }
 
     //Conto un iterazione fatta
     // (*numiter) += 1;
 
-    pthread_t tid[thread_count];
     pagerank_shared_attr shared;
 
-    pthread_mutex_t cond_mux;
-    pthread_cond_t cond;
-    xpthread_mutex_init(&cond_mux, HERE);
-    xpthread_cond_init(&cond, HERE);
+    /**
+     * spinning only pays off if every thread has its own
+     * core: when oversubscribed, park at once
+     */
+    spin_barrier barrier;
+    barrier_init(&barrier, thread_count, (thread_count <= sysconf(_SC_NPROCESSORS_ONLN)) ? BARRIER_SPIN : 0);
+    pagerank_partial *partial = xaligned_alloc(CACHE_LINE, thread_count * sizeof(pagerank_partial), HERE);
 
-    shared.cond             = &cond;
-    shared.cond_mux         = &cond_mux;
+    shared.barrier          = &barrier;
+    shared.partial          = partial;
     shared.curr_iter        = iter_count;
-    shared.do_X             = false;
-    shared.do_Y             = true;
     shared.dumping_factor   = dumping;
     shared.epsilon          = eps;
-    shared.error            = 0.0;
     shared.exit             = false;
     shared.grph             = grph;
     shared.max_iter         = max_iter;
     shared.S_t              = ((double)grph->dead_count) * init;
-    shared.S_t_shared       = 0;
+
+    //warm start: dead end mass of the given vector
+    if(opts != NULL && opts->init != NULL){
+        shared.S_t = 0.0;
+        for(int i = 0; i<grph->nodes; i++)
+            if(grph->out[i] == 0)
+                shared.S_t += opts->init[i];
+    }
+    shared.mass             = 1.0;
     shared.thread_count     = thread_count;
     shared.shared_mux       = &signal_mux;
-    shared.waiting_on_X     = 0;
-    shared.waiting_on_Y     = 0;
     shared.X_previous       = &X_previous;
     shared.X_current        = &X_current;
     shared.Y                = Y;
+    shared.Xf_previous      = &Xf_previous;
+    shared.Xf_current       = &Xf_current;
+    shared.Yf               = Yf;
+    shared.inv_out          = inv_out;
+    shared.precision        = precision;
+    shared.solver           = solver;
+    shared.error            = 0.0;
+    shared.adapt_tol        = (opts != NULL) ? opts->adaptive : 0.0;
+    shared.frozen           = NULL;
+    shared.adapt_sums       = NULL;
+    shared.adapt_full       = true;     //nothing frozen yet
+    shared.adapt_since      = 0;
+    shared.adapt_checks     = 0;
+    shared.adapt_edges      = 0;
+    shared.teleport         = (opts != NULL) ? opts->teleport : NULL;
+    shared.init             = (opts != NULL) ? opts->init : NULL;
+    shared.iteration        = 0;
+    shared.extrapolations   = 0;
+    shared.extrap_rejected  = 0;
+    shared.extrap_pending   = false;
+    shared.extrap_restore   = false;
+    shared.extrap_error     = 0.0;
+    shared.extrap_S_t       = 0.0;
+    shared.extrap_scale     = 1.0;
+    shared.extrapolate      = (opts != NULL && solver == SOLVER_JACOBI && precision != PREC_FLOAT) ? opts->extrapolate : EXTRAP_NONE;
+
+    //history ring: x(t-2) for aitken, also x(t-3) for quadratic
+    for(int h = 0; h<EXTRAP_HISTORY; h++)
+        shared.history[h] = (shared.extrapolate != EXTRAP_NONE && h < shared.extrapolate) ? xmalloc(grph->nodes * sizeof(double), HERE) : NULL;
+    shared.active_log       = xmalloc(max_iter * sizeof(long), HERE);
+    shared.log_len          = 0;
+    shared.perf_iter        = (max_iter < PERF_MAX_ITER) ? max_iter : PERF_MAX_ITER;
+    shared.perf_log         = (perf != NULL) ? xcalloc((size_t)thread_count * shared.perf_iter * 2, sizeof(perf_sample), HERE) : NULL;
+
+    //adaptive mode: Jacobi with double X only
+    if(shared.adapt_tol > 0.0 && solver == SOLVER_JACOBI && precision != PREC_FLOAT){
+        shared.frozen       = xcalloc(grph->nodes, sizeof(unsigned char), HERE);
+        shared.adapt_sums   = xcalloc(grph->nodes, sizeof(double), HERE);
+    }
+    shared.gather           = gather_select((opts != NULL) ? opts->kernel : KERNEL_AUTO, &kernel);
+    shared.gather_f         = gather_f_select((opts != NULL) ? opts->kernel : KERNEL_AUTO, NULL);
+
+    //push: Jacobi in double on every node
+    shared.direction        = (opts != NULL && solver == SOLVER_JACOBI && precision == PREC_DOUBLE && shared.frozen == NULL) ? opts->direction : DIR_PULL;
+    shared.push             = (shared.direction == DIR_PUSH);
+    shared.push_src         = NULL;
+    shared.push_dst         = NULL;
+    shared.bin_start        = NULL;
+    shared.bin_target       = NULL;
+    shared.bin_value        = NULL;
+    shared.probe_time[0]    = 0.0;
+    shared.probe_time[1]    = 0.0;
+    if(shared.direction != DIR_PULL)
+        pagerank_push_setup(&shared, pool);
+    shared.schedule         = schedule;
+    shared.next_chunk       = 0;
+    shared.timed            = (opts != NULL && opts->report != NULL);
+    shared.metrics          = (opts != NULL) ? opts->metrics : NULL;
+    shared.metrics_log      = (shared.metrics != NULL) ? xaligned_alloc(CACHE_LINE, thread_count * 2 * sizeof(pagerank_metrics), HERE) : NULL;
+
+    /**
+     * X phase ranges: balanced on the in-edges (one per
+     * thread, or SCHED_CHUNKS per thread for the dynamic
+     * schedule) or plain equal node ranges
+     */
+    shared.chunk_count      = (schedule == SCHED_DYNAMIC) ? thread_count * SCHED_CHUNKS : thread_count;
+    shared.bounds           = xmalloc((shared.chunk_count + 1) * sizeof(int), HERE);
+
+    if(schedule == SCHED_NODES){
+        for(int i = 0; i<=thread_count; i++)
+            shared.bounds[i] = (int)(((long)grph->nodes * i) / thread_count);
+    }
+    else
+        graph_partition(grph, shared.chunk_count, shared.bounds);
+
+    // popolamento vettori iterazioni
+    pool_parallel_for(pool, 0, grph->nodes, PAGERANK_CHUNK, pagerank_init_body, &shared);
     
     pagerank_thread_attr thread_attr[thread_count];
-    int int_start = 0;
-    const int int_length = (int)(grph->nodes /thread_count);
+    shared.probe_mark = monotonic_time();
 
     for(int i = 0; i < thread_count; i++){
-        thread_attr[i].interval_start   = int_start;
-        thread_attr[i].interval_end     = (i == thread_count - 1)? grph->nodes -1 : int_start + int_length;
+        thread_attr[i].id               = i;
+        thread_attr[i].interval_start   = (int)(((long)grph->nodes * i) / thread_count);
+        thread_attr[i].interval_end     = (int)(((long)grph->nodes * (i + 1)) / thread_count);
+        thread_attr[i].nodes            = 0;
+        thread_attr[i].edges            = 0;
+        thread_attr[i].busy             = 0.0;
         thread_attr[i].shared           = &shared;
-        xpthread_create(&tid[i], pagerank_routine, &(thread_attr[i]), HERE);
-
-        int_start += int_length +1 ;
+        pool_submit(pool,pagerank_routine,&(thread_attr[i]));
     }
 
-    for(int i = 0; i < thread_count; i++){
-        xpthread_join(tid[i], NULL, HERE);
-    }
+    pool_wait(pool);
 
     *iter_count = *(shared.curr_iter);
 
+    if(opts != NULL)
+        opts->error = shared.error;
+
+    const bool adaptive = (shared.frozen != NULL);
+    if(adaptive)
+        pagerank_adaptive_report(stderr, shared.active_log, shared.log_len, grph, shared.adapt_checks, shared.adapt_edges);
+
+    if(shared.extrapolate != EXTRAP_NONE)
+        fprintf(stderr, "Extrapolation: %s, %d steps applied, %d rejected (every %d iterations)\n",
+            (shared.extrapolate == EXTRAP_AITKEN) ? "aitken" : "quadratic", shared.extrapolations, shared.extrap_rejected, EXTRAP_PERIOD);
+
+    if(opts != NULL)
+        opts->extrapolations = shared.extrapolations;
+
+    if(shared.direction == DIR_AUTO && *iter_count > 2)
+        fprintf(stderr, "Direction: %s (pull %.6f s, push %.6f s per iteration)\n",
+            (shared.bin_value != NULL) ? "push" : "pull", shared.probe_time[0], shared.probe_time[1]);
+
+    free(shared.push_src);
+    free(shared.push_dst);
+    free(shared.bin_start);
+    free(shared.bin_target);
+    free(shared.bin_value);
+
+    for(int h = 0; h<EXTRAP_HISTORY; h++)
+        free(shared.history[h]);
+    free(shared.frozen);
+    free(shared.adapt_sums);
+    free(shared.active_log);
+
+    //Gauss-Seidel solution scaled to sum 1
+    if(solver == SOLVER_GS)
+        for(int i = 0; i<grph->nodes; i++)
+            X_current[i] /= shared.mass;
+
+    if(shared.timed)
+        pagerank_report(opts->report, thread_attr, thread_count, schedule, kernel, *iter_count);
+
+    if(shared.metrics_log != NULL){
+        if(shared.iteration > 0)
+            pagerank_metrics_emit(&shared, shared.iteration - 1);
+        free(shared.metrics_log);
+    }
+
+    if(shared.perf_log != NULL){
+        perf_iterations(perf, shared.perf_log, thread_count, shared.perf_iter, *iter_count);
+        free(shared.perf_log);
+    }
+
+    free(shared.bounds);
+    free(inv_out);
     free(Y);
-    xpthread_mutex_destroy(&cond_mux, HERE);
-    xpthread_cond_destroy(&cond, HERE);    
+    free(Yf);
+    free(partial);
+    barrier_destroy(&barrier);
+
+    //ranks are always returned in double
+    if(precision == PREC_FLOAT){
+        X_current = xmalloc(grph->nodes * sizeof(double), HERE);
+        for(int i = 0; i<grph->nodes; i++)
+            X_current[i] = (double)Xf_current[i];
+        free(Xf_current);
+    }
 
     return X_current;
 }
@@ -364,15 +1731,25 @@ void *signal_handler_routine(void *attr){
                 if(*(arg->iter_count)==0){
                     action = 0;
                 }
-                else if(*(arg->X_previous) == NULL){
+                else if(*(arg->X_previous) == NULL && *(arg->Xf_previous) == NULL){
                     action = 1;
                 }
-                else {
+                else if(*(arg->X_previous) != NULL){
                     curr_index  = find_max(*(arg->X_previous),*(arg->nodes));
                     curr_max    = (*(arg->X_previous))[curr_index];
                     iter_count  = *(arg->iter_count);
                     action      = 2;
                 }
+                else {
+                    const float *ranks = *(arg->Xf_previous);
+                    curr_index  = 0;
+                    for(int i = 1; i<*(arg->nodes); i++)
+                        if(ranks[i] > ranks[curr_index])
+                            curr_index = i;
+                    curr_max    = ranks[curr_index];
+                    iter_count  = *(arg->iter_count);
+                    action      = 2;
+                }
             xpthread_mutex_unlock(arg->shared_mux,HERE);
 
             switch(action){
@@ -424,15 +1801,11 @@ void graph_save(char *path, graph *grph){
     //print brief graph info
     printGraphInfo(grph,file,true);
     //print first line
-    fprintf(file,"%d %d %d %d\n",grph->nodes,grph->nodes,grph->edges,grph->dead_count);
+    fprintf(file,"%d %d %ld %d\n",grph->nodes,grph->nodes,grph->edges,grph->dead_count);
     //print all valid edges
-    inmap *curr_obj;
     for(int i = 0; i<grph->nodes;i++){
-        curr_obj = grph->in[i];
-        if(curr_obj == NULL)
-            continue;
-        for(int j = 0; j<curr_obj->length;j++){
-            fprintf(file,"%d %d\n",curr_obj->vector[j],i);
+        for(edge_t j = grph->offsets[i]; j<grph->offsets[i+1];j++){
+            fprintf(file,"%d %d\n",grph->sources[j],i);
         }
     }
     
@@ -7,8 +7,150 @@
 #include <sys/time.h>
 
 #include "lib_graph.h"
+#include "lib_threads.h"
+#include "lib_kernels.h"
+#include "lib_perf.h"
+
+//nodes handed out at once by the parallel for loops
+#ifndef PAGERANK_CHUNK
+#define PAGERANK_CHUNK 4096
+#endif
+
+/**
+ * work schedule of the X phase
+ *  SCHED_EDGES:    static ranges with the same number of in-edges (default)
+ *  SCHED_NODES:    static ranges with the same number of nodes
+ *  SCHED_DYNAMIC:  edge balanced chunks taken from a shared counter
+ */
+#define SCHED_EDGES     0
+#define SCHED_NODES     1
+#define SCHED_DYNAMIC   2
+
+//chunks per thread of the dynamic schedule
+#ifndef SCHED_CHUNKS
+#define SCHED_CHUNKS 16
+#endif
+
+/**
+ * storage of the rank vectors (X) and of the contribution
+ * vector Y, the reductions (error, S_t) are always double
+ *  PREC_DOUBLE:    X and Y double (default)
+ *  PREC_FLOAT:     X and Y float, half the memory traffic
+ *  PREC_MIXED:     X double, Y float (the randomly read one)
+ */
+#define PREC_DOUBLE     0
+#define PREC_FLOAT      1
+#define PREC_MIXED      2
+
+/**
+ * iteration scheme
+ *  SOLVER_JACOBI:  X_current from X_previous, swap at each
+ *                  iteration (default)
+ *  SOLVER_GS:      Gauss-Seidel in place: one rank vector,
+ *                  each thread updates its nodes in order
+ *                  reading the newest values, asynchronous
+ *                  across threads (double precision only).
+ *                  The race on Y between threads is intended
+ *                  (relaxed atomics in pagerank_sweep()): a
+ *                  TSan report on it is expected
+ */
+#define SOLVER_JACOBI   0
+#define SOLVER_GS       1
+
+/**
+ * adaptive mode: a node whose relative change stayed below
+ * the threshold for ADAPT_STREAK iterations is frozen and
+ * no longer recomputed (Jacobi with double X only). At most
+ * ADAPT_CHECK iterations pass between two full iterations,
+ * the only ones that can end the run
+ */
+#ifndef ADAPT_STREAK
+#define ADAPT_STREAK 2
+#endif
+
+#ifndef ADAPT_CHECK
+#define ADAPT_CHECK 8
+#endif
+
+/**
+ * extrapolation of the Jacobi iterates, every EXTRAP_PERIOD
+ * iterations (Kamvar et al.), X double only
+ *  EXTRAP_AITKEN:      componentwise Aitken delta^2 on the
+ *                      last 3 iterates
+ *  EXTRAP_QUADRATIC:   quadratic extrapolation on the last
+ *                      4 iterates (2x2 least squares)
+ * the two Jacobi vectors hold the last 2 iterates, the
+ * older ones are kept in a ring of EXTRAP_HISTORY vectors.
+ * An Aitken step is rejected when the residual of the next
+ * iteration is not below the one before the step: the
+ * iterate it replaced comes back and Jacobi goes on from
+ * there, without further steps. The quadratic residual can
+ * rise for an iteration and still pay off, it is not checked
+ */
+#define EXTRAP_NONE         0
+#define EXTRAP_AITKEN       1
+#define EXTRAP_QUADRATIC    2
+
+#ifndef EXTRAP_PERIOD
+#define EXTRAP_PERIOD 10
+#endif
+
+#define EXTRAP_HISTORY 2
+
+/**
+ * direction of the X phase (Jacobi, double precision, not
+ * adaptive), graph_build_out() is run if needed
+ *  DIR_PULL:   every node sums the Y of its in-edges (default)
+ *  DIR_PUSH:   every node writes its Y along its out-edges
+ *              into the bins of the destination ranges, then
+ *              each thread sums the bins of its own range:
+ *              no atomics, every bin has a single writer
+ *  DIR_AUTO:   one iteration of each after the first one,
+ *              then the faster of the two for the rest of the
+ *              run, never switched again (the bins are freed
+ *              if pull wins)
+ */
+#define DIR_PULL    0
+#define DIR_PUSH    1
+#define DIR_AUTO    2
+
+//nodes per block of the float X phase (sums kept on the stack)
+#ifndef GATHER_BLOCK
+#define GATHER_BLOCK 256
+#endif
+
+/**
+ * --perf keeps the Y and X samples of the first PERF_MAX_ITER
+ * iterations only (64 bytes per sample, thread and phase):
+ * the log is allocated before the run, on min(max_iter,
+ * PERF_MAX_ITER) iterations. The phase totals cover the
+ * whole run anyway
+ */
+#ifndef PERF_MAX_ITER
+#define PERF_MAX_ITER 1000
+#endif
+
+/**
+ * optional knobs of pagerank(), NULL means defaults
+ */
+typedef struct pagerank_opts{
+    int     schedule;
+    int     kernel;         //KERNEL_* of lib_kernels.h
+    int     precision;      //PREC_*
+    int     solver;         //SOLVER_*
+    double  adaptive;       //per node relative threshold, 0 = off
+    int     extrapolate;    //EXTRAP_*
+    int     direction;      //DIR_*
+    const double *teleport; //personalization vector (sum 1), NULL = uniform
+    const double *init;     //warm start vector (sum 1), NULL = uniform
+    FILE    *report;        //per-thread load report, NULL = none
+    FILE    *metrics;       //per iteration JSON lines, NULL = none
+    double  error;          //out: L1 error of the last iteration
+    int     extrapolations; //out: extrapolation steps kept
+}pagerank_opts;
 
 extern double *X_previous;
+extern float  *Xf_previous;
 extern pthread_mutex_t signal_mux;
 
 void graph_save(char *path, graph *grph);
@@ -21,43 +163,148 @@ void printGraphInfo(graph *g, FILE *stream,bool comment);
 
 void *calculate_pagerank(void *arg);
 
-double *pagerank(graph *g, double d, double eps, int maxiter, int taux, int *numiter);
 
-int *find_K_Max(double *ranks, int length,int k);
+/**
+ * find_K_Max()
+ * ------------
+ * ids of the k highest ranks, best first (ties: lower id
+ * first), k is clamped to [0, length]. Reentrant (no
+ * static state, `ranks` is only read). Parallel on `pool`
+ * (NULL: sequential), ranges shorter than TOPK_MIN_RANGE
+ * nodes are not split
+ */
+#ifndef TOPK_MIN_RANGE
+#define TOPK_MIN_RANGE 65536
+#endif
+
+int *find_K_Max(const double *ranks, int length, int k, thread_pool *pool);
 
-void printStats(double *ranks,int length,int iter_count,int max_iter,int k, FILE *stream);
+void printStats(const double *ranks,int length,int iter_count,int max_iter,double error,int k, thread_pool *pool, FILE *stream);
+
+/**
+ * ### Rank vectors
+ * ----------------
+ * layout: magic | int64 nodes | ranks[nodes] (native
+ * doubles). ranks_load() checks the node count and scales
+ * the vector to sum 1, for the warm start of pagerank()
+ */
+#define RANKS_MAGIC "PRRANKS"
+
+void ranks_save(const char *path, const double *ranks, int nodes);
+
+double *ranks_load(const char *path, int nodes);
+
+/**
+ * per-thread partial sums of an iteration, on their own
+ * cache lines (reduced by the last thread at the barrier).
+ * The alignment pads the size to a multiple of the line
+ */
+typedef struct pagerank_partial{
+    double error;
+    double S_t;
+    double mass;
+    long   active;      //nodes recomputed (adaptive mode)
+    long   gathered;    //in-edges read (adaptive mode)
+    double dot[5];      //quadratic extrapolation products
+}__attribute__((aligned(CACHE_LINE))) pagerank_partial;
+
+/**
+ * per-thread timings of an iteration (--metrics), on their
+ * own cache lines. Two slots per thread: the line of an
+ * iteration is written by the serial section of the next
+ * one, when every thread has left the barrier
+ */
+typedef struct pagerank_metrics{
+    double y_busy;
+    double y_wait;      //at the barrier after Y
+    double x_busy;
+    double x_wait;      //at the barrier after X
+    long   edges;       //in-edges of the X ranges
+}__attribute__((aligned(CACHE_LINE))) pagerank_metrics;
 
 typedef struct pagerank_shared_attr {
     //doppi puntatori per i vettori delle iterazioni per fare lo swap
     double          **X_current;
     double          **X_previous;
     double          *Y;
+    float           **Xf_current;
+    float           **Xf_previous;
+    float           *Yf;
+    double          *inv_out;
+    int             precision;
+    int             solver;
+    double          error;
+    unsigned char   *frozen;
+    double          *adapt_sums;    //adaptive: last in-edge sum of each node
+    double          adapt_tol;
+    bool            adapt_full;     //adaptive: recompute every node (convergence check)
+    int             adapt_since;    //adaptive: iterations since the last full one
+    int             adapt_checks;   //adaptive: full iterations done
+    long            adapt_edges;    //adaptive: in-edges read
+    const double    *teleport;      //NULL = uniform
+    const double    *init;          //warm start, NULL = uniform
+    int             extrapolate;
+    double          *history[EXTRAP_HISTORY];  //x(k-2), x(k-3)
+    double          extrap_coef[3];
+    double          extrap_scale;
+    int             extrapolations;
+    int             extrap_rejected;
+    bool            extrap_pending; //the last iteration started from an extrapolated vector
+    bool            extrap_restore; //put back the iterate replaced by the rejected step
+    double          extrap_error;   //residual before the step
+    double          extrap_S_t;     //S_t of the replaced iterate
+    int             iteration;      //iterations done in this run
+    long            *active_log;    //active nodes of each iteration
+    int             log_len;
+    perf_sample     *perf_log;      //Y and X samples per thread and iteration, NULL = off
+    int             perf_iter;      //iterations in perf_log, min(max_iter, PERF_MAX_ITER)
+    FILE            *metrics;
+    pagerank_metrics *metrics_log;  //2 slots per thread, NULL = off
+    double          metrics_error[2];
+    double          metrics_S_t[2];
+    gather_fn       gather;
+    gather_f_fn     gather_f;
+    int             direction;
+    bool            push;           //this iteration scatters
+    int             *push_src;      //source ranges, balanced on the out-edges
+    int             *push_dst;      //destination ranges, balanced on the in-edges
+    edge_t          *bin_start;     //bin of (destination p, source t) at p * threads + t
+    int             *bin_target;
+    double          *bin_value;
+    double          probe_mark;     //auto: start of the iteration
+    double          probe_time[2];  //auto: pull, push iteration
     double          S_t;
-    double          S_t_shared;
+    double          mass;
     double          epsilon;
-    double          error;
     double          dumping_factor;
     graph           *grph;
     int             max_iter;
-    bool            do_X;
-    bool            do_Y;
     bool            exit;
-    int             waiting_on_Y;
-    int             waiting_on_X;
     int             *curr_iter;
     int             thread_count;
-    pthread_mutex_t *cond_mux;
+    pagerank_partial *partial;
+    int             schedule;
+    int             *bounds;
+    int             chunk_count;
+    int             next_chunk;
+    bool            timed;
+    spin_barrier    *barrier;
     pthread_mutex_t *shared_mux;
-    pthread_cond_t  *cond;
 } pagerank_shared_attr;
 
 typedef struct pagerank_thread_attr{
+    int id;
     int interval_start;
     int interval_end;
+    long nodes;
+    long edges;
+    double busy;
     pagerank_shared_attr *shared;
 }pagerank_thread_attr;
 
-double *pagerank(graph *grph, double dumping, double eps, int max_iter, int thread_count, int *iter_count);
+double *pagerank(graph *grph, double dumping, double eps, int max_iter, thread_pool *pool, pagerank_opts *opts, int *iter_count);
+
+void pagerank_init_body(void *, int, int);
 
 void *pagerank_routine(void *);
 
@@ -65,6 +312,7 @@ typedef struct sig_handler_attr{
     int             *nodes;
     int             *iter_count;
     double          **X_previous;
+    float           **Xf_previous;
     pthread_mutex_t *shared_mux;
     FILE            *signal_stream;
 
@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+#include "lib_perf.h"
+#include "lib_supp.h"
+
+#define HERE __FILE__,__LINE__
+
+perf_session *perf = NULL;
+
+static const char *perf_names[PERF_EVENTS] = {
+    "cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses", "task_clock_ns", "page_faults"
+};
+
+static void perf_event_config(int event, struct perf_event_attr *attr){
+    memset(attr, 0, sizeof(*attr));
+    attr->size              = sizeof(*attr);
+    attr->exclude_kernel    = 1;
+    attr->exclude_hv        = 1;
+    attr->read_format       = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch(event){
+        case PERF_CYCLES:
+            attr->type      = PERF_TYPE_HARDWARE;
+            attr->config    = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attr->type      = PERF_TYPE_HARDWARE;
+            attr->config    = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_LLC_MISSES:
+            attr->type      = PERF_TYPE_HARDWARE;
+            attr->config    = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PERF_DTLB_MISSES:
+            attr->type      = PERF_TYPE_HW_CACHE;
+            attr->config    = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_BRANCH_MISSES:
+            attr->type      = PERF_TYPE_HARDWARE;
+            attr->config    = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PERF_TASK_CLOCK:
+            attr->type      = PERF_TYPE_SOFTWARE;
+            attr->config    = PERF_COUNT_SW_TASK_CLOCK;
+            break;
+        default:
+            attr->type      = PERF_TYPE_SOFTWARE;
+            attr->config    = PERF_COUNT_SW_PAGE_FAULTS;
+            break;
+    }
+}
+
+static double perf_clock(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+perf_session *perf_open(FILE *stream){
+    perf_session *s = xmalloc(sizeof(perf_session), HERE);
+    int size = 16;
+
+    s->stream   = stream;
+    s->count    = 0;
+    s->threads  = xmalloc(size * sizeof(perf_thread), HERE);
+
+    DIR *dir = opendir("/proc/self/task");
+    if(dir == NULL)
+        error("[perf_open] /proc/self/task", HERE);
+
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL){
+        if(entry->d_name[0] == '.')
+            continue;
+
+        if(s->count == size){
+            size       *= 2;
+            s->threads  = xrealloc(s->threads, size * sizeof(perf_thread), HERE);
+        }
+
+        perf_thread *t = &(s->threads[s->count++]);
+        t->tid = (pid_t)atoi(entry->d_name);
+
+        for(int e = 0; e<PERF_EVENTS; e++){
+            struct perf_event_attr attr;
+            perf_event_config(e, &attr);
+            t->fd[e] = (int)syscall(SYS_perf_event_open, &attr, t->tid, -1, -1, 0);
+        }
+    }
+    closedir(dir);
+
+    //main thread first, then the workers by tid
+    const pid_t self = (pid_t)syscall(SYS_gettid);
+    for(int i = 0; i<s->count; i++){
+        if(s->threads[i].tid == self){
+            perf_thread tmp = s->threads[0];
+            s->threads[0]   = s->threads[i];
+            s->threads[i]   = tmp;
+        }
+    }
+
+    s->last = xmalloc(s->count * sizeof(perf_values), HERE);
+    for(int i = 0; i<s->count; i++)
+        perf_read(&(s->threads[i]), &(s->last[i]));
+    s->last_time = perf_clock();
+
+    fprintf(s->stream, "{\"type\":\"events\",\"threads\":%d", s->count);
+    for(int e = 0; e<PERF_EVENTS; e++)
+        fprintf(s->stream, ",\"%s\":%s", perf_names[e], (s->threads[0].fd[e] >= 0) ? "true" : "false");
+    fprintf(s->stream, "}\n");
+
+    return s;
+}
+
+void perf_close(perf_session *s){
+    for(int i = 0; i<s->count; i++)
+        for(int e = 0; e<PERF_EVENTS; e++)
+            if(s->threads[i].fd[e] >= 0)
+                close(s->threads[i].fd[e]);
+
+    fflush(s->stream);
+    free(s->threads);
+    free(s->last);
+    free(s);
+}
+
+perf_thread *perf_self(perf_session *s){
+    const pid_t self = (pid_t)syscall(SYS_gettid);
+
+    for(int i = 0; i<s->count; i++)
+        if(s->threads[i].tid == self)
+            return &(s->threads[i]);
+    return NULL;
+}
+
+void perf_read(const perf_thread *t, perf_values *out){
+    for(int e = 0; e<PERF_EVENTS; e++){
+        uint64_t buff[3];   //value, time enabled, time running
+
+        out->v[e] = 0;
+        if(t->fd[e] < 0 || read(t->fd[e], buff, sizeof(buff)) != sizeof(buff))
+            continue;
+
+        if(buff[2] > 0 && buff[2] < buff[1])
+            out->v[e] = (uint64_t)((double)buff[0] * (double)buff[1] / (double)buff[2]);
+        else
+            out->v[e] = buff[0];
+    }
+}
+
+void perf_delta(const perf_values *before, const perf_values *after, perf_values *out){
+    for(int e = 0; e<PERF_EVENTS; e++)
+        out->v[e] = after->v[e] - before->v[e];
+}
+
+static void perf_print_values(FILE *stream, const perf_thread *t, const perf_values *v){
+    for(int e = 0; e<PERF_EVENTS; e++){
+        if(t->fd[e] >= 0)
+            fprintf(stream, ",\"%s\":%lu", perf_names[e], (unsigned long)v->v[e]);
+        else
+            fprintf(stream, ",\"%s\":null", perf_names[e]);
+    }
+}
+
+void perf_phase(perf_session *s, const char *name){
+    const double now = perf_clock();
+
+    for(int i = 0; i<s->count; i++){
+        perf_values curr, delta;
+        perf_read(&(s->threads[i]), &curr);
+        perf_delta(&(s->last[i]), &curr, &delta);
+        s->last[i] = curr;
+
+        fprintf(s->stream, "{\"type\":\"phase\",\"phase\":\"%s\",\"thread\":%d,\"tid\":%d,\"time\":%.9f",
+            name, i, (int)s->threads[i].tid, now - s->last_time);
+        perf_print_values(s->stream, &(s->threads[i]), &delta);
+        fprintf(s->stream, "}\n");
+    }
+
+    s->last_time = now;
+}
+
+void perf_iterations(perf_session *s, const perf_sample *log, int thread_count, int max_iter, int iterations){
+    static const char *phases[] = {"Y", "X"};
+
+    //the counters of a thread are the same for all its samples
+    for(int it = 0; it<iterations && it<max_iter; it++){
+        for(int t = 0; t<thread_count; t++){
+            for(int p = 0; p<2; p++){
+                const perf_sample *sample = &log[((size_t)t * max_iter + it) * 2 + p];
+
+                fprintf(s->stream, "{\"type\":\"iteration\",\"iteration\":%d,\"phase\":\"%s\",\"thread\":%d,\"time\":%.9f",
+                    it + 1, phases[p], t, sample->time);
+                perf_print_values(s->stream, &(s->threads[0]), &(sample->c));
+                fprintf(s->stream, "}\n");
+            }
+        }
+    }
+}
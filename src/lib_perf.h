@@ -0,0 +1,98 @@
+#ifndef LIBPERF
+#define LIBPERF
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * ### Hardware Counters
+ * ---------------------
+ * perf_event_open() counters on every thread of the process
+ * (main thread and pool workers, enumerated from
+ * /proc/self/task), user space only. A counter the kernel or
+ * the cpu does not offer (e.g. hardware events in a VM) is
+ * left closed and reported as null.
+ *
+ * perf_phase() is called by the main thread between phases
+ * (pool idle) and reports what every thread counted since
+ * the previous call. pagerank_routine() reads the counters
+ * of its own thread around the Y and X phases of every
+ * iteration, the samples are written by perf_iterations()
+ * after the run.
+ *
+ * The report is one JSON object per line:
+ *      {"type":"events", ...}      counters available
+ *      {"type":"phase", ...}       per phase, per thread
+ *      {"type":"iteration", ...}   per iteration, phase, thread
+ * Counts are scaled by enabled / running time when the
+ * kernel multiplexes the counters.
+ */
+
+#define PERF_CYCLES         0
+#define PERF_INSTRUCTIONS   1
+#define PERF_LLC_MISSES     2
+#define PERF_DTLB_MISSES    3
+#define PERF_BRANCH_MISSES  4
+#define PERF_TASK_CLOCK     5   //ns, software
+#define PERF_PAGE_FAULTS    6   //software
+#define PERF_EVENTS         7
+
+typedef struct perf_values{
+    uint64_t v[PERF_EVENTS];
+}perf_values;
+
+typedef struct perf_thread{
+    pid_t   tid;
+    int     fd[PERF_EVENTS];        //-1 if not available
+}perf_thread;
+
+/**
+ * one sample of a pagerank phase: wall time and counters
+ */
+typedef struct perf_sample{
+    double      time;
+    perf_values c;
+}perf_sample;
+
+typedef struct perf_session{
+    FILE        *stream;
+    int         count;              //threads
+    perf_thread *threads;
+    perf_values *last;              //per thread, at the previous phase
+    double      last_time;
+}perf_session;
+
+//set by the caller (pagerank --perf), NULL = counters off
+extern perf_session *perf;
+
+perf_session *perf_open(FILE *stream);
+
+void perf_close(perf_session *s);
+
+/**
+ * perf_self()
+ * -----------
+ * counters of the calling thread, NULL if it was created
+ * after perf_open()
+ */
+perf_thread *perf_self(perf_session *s);
+
+void perf_read(const perf_thread *t, perf_values *out);
+
+//out = after - before
+void perf_delta(const perf_values *before, const perf_values *after, perf_values *out);
+
+void perf_phase(perf_session *s, const char *name);
+
+/**
+ * perf_iterations()
+ * -----------------
+ * log[(thread * max_iter + iteration) * 2 + phase] with
+ * phase 0 = Y, 1 = X, for the first `iterations` iterations
+ * (at most max_iter, the iterations the log holds)
+ */
+void perf_iterations(perf_session *s, const perf_sample *log, int thread_count, int max_iter, int iterations);
+
+#endif
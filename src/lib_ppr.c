@@ -0,0 +1,433 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "lib_ppr.h"
+#include "lib_graph.h"
+#include "lib_supp.h"
+#include "lib_threads.h"
+
+/**
+ * state shared by the batch threads
+ */
+typedef struct ppr_shared_attr{
+    const graph     *grph;
+    double          *X_current;
+    double          *X_previous;
+    double          *Y;
+    double          *inv_out;
+    int             batch;          //vectors per node
+    const int       *seed_offsets;  //node -> (set, weight) lists
+    const int       *seed_set;
+    const double    *seed_weight;
+    double          dumping_factor;
+    double          epsilon;
+    int             max_iter;
+    int             curr_iter;
+    bool            exit;
+    double          error;          //largest L1 error of the batch
+    double          *S_t;           //dead end mass per vector
+    double          *partial;       //per thread error[batch], S_t[batch]
+    int             stride;         //doubles per thread slot
+    int             thread_count;
+    int             *bounds;
+    spin_barrier    *barrier;
+}ppr_shared_attr;
+
+typedef struct ppr_thread_attr{
+    int id;
+    int interval_start;             //Y phase nodes
+    int interval_end;
+    ppr_shared_attr *shared;
+}ppr_thread_attr;
+
+/**
+ * seed sets under construction: `length` entries stored,
+ * the open set starts at offsets[count]
+ */
+typedef struct seeds_builder{
+    seed_sets   *s;
+    int         length;
+    int         size;           //entries allocated
+    int         sets_size;      //offsets allocated
+}seeds_builder;
+
+//`node` is a file id, 1-based as in the graph file
+static void seeds_add(seeds_builder *sb, int nodes, long node, double weight, const char *path, int line){
+    seed_sets *s = sb->s;
+
+    if(node < 1 || node > nodes || !(weight > 0.0) || !isfinite(weight)){
+        fprintf(stderr,"[ppr] %s:%d: invalid seed %ld (weight %g)\n", path, line, node, weight);
+        exit(EXIT_FAILURE);
+    }
+
+    if(sb->length == sb->size){
+        sb->size    = (sb->size > 0) ? 2 * sb->size : 64;
+        s->nodes    = xrealloc(s->nodes, sb->size * sizeof(int), HERE);
+        s->weights  = xrealloc(s->weights, sb->size * sizeof(double), HERE);
+    }
+
+    s->nodes[sb->length]    = (int)(node - 1);
+    s->weights[sb->length]  = weight;
+    sb->length++;
+}
+
+static void seeds_invalid(const char *tok, const char *path, int line){
+    fprintf(stderr,"[ppr] %s:%d: invalid seed %s\n", path, line, tok);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * seeds_token()
+ * -------------
+ * a seed "node[:weight]" (batch) or the node of a "node
+ * [weight]" line: the node ends at `sep` or at the end of
+ * the token, the weight at the end. Anything else is an
+ * invalid seed, reported with its path:line
+ */
+static void seeds_token(seeds_builder *sb, int nodes, const char *tok, const char *weight_tok, char sep, const char *path, int line){
+    char *end;
+    double weight = 1.0;
+
+    long node = strtol(tok, &end, 10);
+    if(end == tok || (*end != '\0' && *end != sep))
+        seeds_invalid(tok, path, line);
+
+    if(*end == sep && sep != '\0')
+        weight_tok = end + 1;
+    if(weight_tok != NULL){
+        weight = strtod(weight_tok, &end);
+        if(end == weight_tok || *end != '\0')
+            seeds_invalid((sep == '\0') ? weight_tok : tok, path, line);
+    }
+
+    seeds_add(sb, nodes, node, weight, path, line);
+}
+
+//closes the open set (if not empty), weights scaled to sum 1
+static void seeds_close(seeds_builder *sb){
+    seed_sets *s    = sb->s;
+    const int first = s->offsets[s->count];
+    double sum = 0.0;
+
+    if(sb->length == first)
+        return;
+
+    for(int j = first; j<sb->length; j++)
+        sum += s->weights[j];
+    for(int j = first; j<sb->length; j++)
+        s->weights[j] /= sum;
+
+    if(s->count + 2 > sb->sets_size){
+        sb->sets_size   *= 2;
+        s->offsets      = xrealloc(s->offsets, sb->sets_size * sizeof(int), HERE);
+    }
+    s->offsets[++s->count] = sb->length;
+}
+
+seed_sets *seeds_parse(const char *path, int nodes, bool one_set){
+    FILE *file      = xfopen(path, "r", HERE);
+    seeds_builder sb;
+
+    sb.s            = xmalloc(sizeof(seed_sets), HERE);
+    sb.length       = 0;
+    sb.size         = 0;
+    sb.sets_size    = 16;
+    sb.s->count     = 0;
+    sb.s->offsets   = xmalloc(sb.sets_size * sizeof(int), HERE);
+    sb.s->nodes     = NULL;
+    sb.s->weights   = NULL;
+    sb.s->offsets[0] = 0;
+
+    char *buff  = NULL;
+    size_t len  = 0;
+    int line    = 0;
+
+    while(getline(&buff, &len, file) != -1){
+        line++;
+        char *save = NULL;
+        char *tok  = strtok_r(buff, " \t\r\n", &save);
+
+        if(tok == NULL || tok[0] == '%' || tok[0] == '#')
+            continue;
+
+        if(one_set){
+            char *w     = strtok_r(NULL, " \t\r\n", &save);
+            char *extra = (w != NULL) ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+            if(extra != NULL)
+                seeds_invalid(extra, path, line);
+            seeds_token(&sb, nodes, tok, w, '\0', path, line);
+            continue;
+        }
+
+        for(; tok != NULL; tok = strtok_r(NULL, " \t\r\n", &save))
+            seeds_token(&sb, nodes, tok, NULL, ':', path, line);
+        seeds_close(&sb);
+    }
+
+    if(one_set)
+        seeds_close(&sb);
+
+    free(buff);
+    xfclose(file, HERE);
+
+    if(sb.s->count == 0){
+        fprintf(stderr,"[ppr] %s: no seeds\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    return sb.s;
+}
+
+void seeds_destroy(seed_sets *s){
+    free(s->offsets);
+    free(s->nodes);
+    free(s->weights);
+    free(s);
+}
+
+void seeds_relabel(seed_sets *s, const int *perm, int nodes){
+    int *inv = xmalloc(nodes * sizeof(int), HERE);
+
+    for(int v = 0; v<nodes; v++)
+        inv[perm[v]] = v;
+    for(int j = 0; j<s->offsets[s->count]; j++)
+        s->nodes[j] = inv[s->nodes[j]];
+
+    free(inv);
+}
+
+double *seeds_vector(const seed_sets *s, int set, int nodes){
+    double *v = xcalloc(nodes, sizeof(double), HERE);
+
+    for(int j = s->offsets[set]; j<s->offsets[set+1]; j++)
+        v[s->nodes[j]] += s->weights[j];
+
+    return v;
+}
+
+double *pagerank_batch_column(const double *X, int nodes, int count, int b){
+    double *col = xmalloc(nodes * sizeof(double), HERE);
+
+    for(int i = 0; i<nodes; i++)
+        col[i] = X[(size_t)i * count + b];
+
+    return col;
+}
+
+/**
+ * ppr_routine()
+ * -------------
+ * same phases of pagerank_routine(), on B values per node:
+ *
+ * Y phase: Y[u][b] = X_previous[u][b] / out(u) on the
+ * thread node range
+ *
+ * X phase: for the nodes of the thread edge balanced range
+ * the in-edges add up the B contiguous Y[src][0..B), then
+ * the jump mass is added only to the sets the node is a
+ * seed of. Error and dead end mass are kept per vector
+ *
+ * serial section: reduction per vector, the batch stops
+ * on the largest error
+ */
+static void *ppr_routine(void *attr){
+    ppr_thread_attr *arg    = (ppr_thread_attr *)attr;
+    ppr_shared_attr *shared = arg->shared;
+    const graph *g          = shared->grph;
+    const int B             = shared->batch;
+    const double d          = shared->dumping_factor;
+    double *error           = shared->partial + (size_t)arg->id * shared->stride;
+    double *dead            = error + B;
+    int sense = 0;
+
+    do{
+        const double *X_prev = shared->X_previous;
+        double       *X_curr = shared->X_current;
+
+        // === Computation of Y components ===
+        for(int u = arg->interval_start; u<arg->interval_end; u++){
+            const double w = shared->inv_out[u];
+            const double *x = X_prev + (size_t)u * B;
+            double       *y = shared->Y + (size_t)u * B;
+
+            for(int b = 0; b<B; b++)
+                y[b] = x[b] * w;
+        }
+
+        barrier_wait(shared->barrier, &sense);
+
+        // === Computation of X components ===
+        for(int b = 0; b<B; b++){
+            error[b]    = 0.0;
+            dead[b]     = 0.0;
+        }
+
+        for(int i = shared->bounds[arg->id]; i<shared->bounds[arg->id+1]; i++){
+            double       *x     = X_curr + (size_t)i * B;
+            const double *xp    = X_prev + (size_t)i * B;
+
+            for(int b = 0; b<B; b++)
+                x[b] = 0.0;
+
+            for(edge_t j = g->offsets[i]; j<g->offsets[i+1]; j++){
+                const double *y = shared->Y + (size_t)g->sources[j] * B;
+                for(int b = 0; b<B; b++)
+                    x[b] += y[b];
+            }
+
+            for(int b = 0; b<B; b++)
+                x[b] *= d;
+
+            for(int j = shared->seed_offsets[i]; j<shared->seed_offsets[i+1]; j++){
+                const int b = shared->seed_set[j];
+                x[b] += ((1.0 - d) + d * shared->S_t[b]) * shared->seed_weight[j];
+            }
+
+            for(int b = 0; b<B; b++)
+                error[b] += fabs(x[b] - xp[b]);
+
+            if(g->out[i] == 0)
+                for(int b = 0; b<B; b++)
+                    dead[b] += x[b];
+        }
+
+        if(barrier_enter(shared->barrier, &sense)){
+            double max_error = 0.0;
+
+            for(int b = 0; b<B; b++){
+                double e = 0.0, s = 0.0;
+                for(int t = 0; t<shared->thread_count; t++){
+                    e += shared->partial[(size_t)t * shared->stride + b];
+                    s += shared->partial[(size_t)t * shared->stride + B + b];
+                }
+                shared->S_t[b] = s;
+                if(e > max_error)
+                    max_error = e;
+            }
+
+            shared->error   = max_error;
+            shared->curr_iter++;
+            if(max_error < shared->epsilon || shared->curr_iter == shared->max_iter)
+                shared->exit = true;
+
+            double *temp        = shared->X_previous;
+            shared->X_previous  = shared->X_current;
+            shared->X_current   = temp;
+
+            barrier_release(shared->barrier, &sense);
+        }
+    } while(shared->exit == false);
+
+    return NULL;
+}
+
+double *pagerank_batch(graph *grph, double dumping, double eps, int max_iter, thread_pool *pool, const seed_sets *s, int first, int count, int *iter_count, double *error){
+    const int nodes         = grph->nodes;
+    const int thread_count  = pool->size;
+    const size_t length     = (size_t)nodes * count;
+    const double init       = 1.0 / (double)nodes;
+
+    double *X_current   = xmalloc(length * sizeof(double), HERE);
+    double *X_previous  = xmalloc(length * sizeof(double), HERE);
+    double *Y           = xmalloc(length * sizeof(double), HERE);
+    double *inv_out     = xmalloc(nodes * sizeof(double), HERE);
+    double *S_t         = xmalloc(count * sizeof(double), HERE);
+
+    for(size_t i = 0; i<length; i++)
+        X_previous[i] = init;
+    for(int i = 0; i<nodes; i++)
+        inv_out[i] = (grph->out[i] > 0) ? 1.0 / (double)grph->out[i] : 0.0;
+    for(int b = 0; b<count; b++)
+        S_t[b] = grph->dead_count * init;
+
+    /**
+     * seeds by node (transpose of the sets of the batch),
+     * the X phase adds the jump only where it lands
+     */
+    int *seed_offsets   = xcalloc(nodes + 1, sizeof(int), HERE);
+    const int seeds     = s->offsets[first + count] - s->offsets[first];
+    int    *seed_set    = xmalloc((seeds + 1) * sizeof(int), HERE);
+    double *seed_weight = xmalloc((seeds + 1) * sizeof(double), HERE);
+
+    for(int j = s->offsets[first]; j<s->offsets[first + count]; j++)
+        seed_offsets[s->nodes[j] + 1]++;
+    for(int v = 0; v<nodes; v++)
+        seed_offsets[v+1] += seed_offsets[v];
+
+    int *cursor = xmalloc(nodes * sizeof(int), HERE);
+    memcpy(cursor, seed_offsets, nodes * sizeof(int));
+    for(int b = 0; b<count; b++){
+        for(int j = s->offsets[first + b]; j<s->offsets[first + b + 1]; j++){
+            const int slot      = cursor[s->nodes[j]]++;
+            seed_set[slot]      = b;
+            seed_weight[slot]   = s->weights[j];
+        }
+    }
+    free(cursor);
+
+    spin_barrier barrier;
+    barrier_init(&barrier, thread_count, (thread_count <= sysconf(_SC_NPROCESSORS_ONLN)) ? BARRIER_SPIN : 0);
+
+    //thread slots rounded up to whole cache lines
+    const int line      = CACHE_LINE / sizeof(double);
+    const int stride    = ((2 * count + line - 1) / line) * line;
+
+    ppr_shared_attr shared;
+    shared.grph             = grph;
+    shared.X_current        = X_current;
+    shared.X_previous       = X_previous;
+    shared.Y                = Y;
+    shared.inv_out          = inv_out;
+    shared.batch            = count;
+    shared.seed_offsets     = seed_offsets;
+    shared.seed_set         = seed_set;
+    shared.seed_weight      = seed_weight;
+    shared.dumping_factor   = dumping;
+    shared.epsilon          = eps;
+    shared.max_iter         = max_iter;
+    shared.curr_iter        = 0;
+    shared.exit             = false;
+    shared.error            = 0.0;
+    shared.S_t              = S_t;
+    shared.stride           = stride;
+    shared.partial          = xaligned_alloc(CACHE_LINE, (size_t)thread_count * stride * sizeof(double), HERE);
+    shared.thread_count     = thread_count;
+    shared.bounds           = xmalloc((thread_count + 1) * sizeof(int), HERE);
+    shared.barrier          = &barrier;
+
+    graph_partition(grph, thread_count, shared.bounds);
+
+    ppr_thread_attr thread_attr[thread_count];
+
+    for(int i = 0; i<thread_count; i++){
+        thread_attr[i].id               = i;
+        thread_attr[i].interval_start   = (int)(((long)nodes * i) / thread_count);
+        thread_attr[i].interval_end     = (int)(((long)nodes * (i + 1)) / thread_count);
+        thread_attr[i].shared           = &shared;
+        pool_submit(pool, ppr_routine, &(thread_attr[i]));
+    }
+
+    pool_wait(pool);
+
+    *iter_count = shared.curr_iter;
+    if(error != NULL)
+        *error = shared.error;
+
+    free(shared.X_current);
+    free(shared.partial);
+    free(shared.bounds);
+    free(seed_offsets);
+    free(seed_set);
+    free(seed_weight);
+    free(S_t);
+    free(inv_out);
+    free(Y);
+    barrier_destroy(&barrier);
+
+    //last iterate
+    return shared.X_previous;
+}
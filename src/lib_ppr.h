@@ -0,0 +1,91 @@
+#ifndef LIBPPR
+#define LIBPPR
+
+#include <stdbool.h>
+
+#include "lib_graph.h"
+#include "lib_threads.h"
+
+/**
+ * ### Personalized PageRank
+ * -------------------------
+ * The random jump (teleport and dead end mass) lands on a
+ * seed set instead of on every node:
+ *
+ *      x = d * A x + ((1-d) + d * S_t) * v
+ *
+ * v is the seed set weights normalized to sum 1.
+ *
+ * A single vector runs through pagerank() (opts.teleport,
+ * see seeds_vector()). pagerank_batch() computes B vectors
+ * in one pass over the graph: the B values of a node are
+ * stored next to each other (X[node * B + b]), so every
+ * in-edge of the X phase reads B contiguous values and the
+ * irregular access is paid once for the whole batch.
+ */
+
+//seed sets per pagerank_batch() call
+#ifndef PPR_BATCH
+#define PPR_BATCH 8
+#endif
+
+/**
+ * seed sets in CSR form: set s is nodes / weights in
+ * [offsets[s], offsets[s+1]), weights sum to 1 in each set
+ */
+typedef struct seed_sets{
+    int     count;
+    int     *offsets;
+    int     *nodes;
+    double  *weights;
+}seed_sets;
+
+/**
+ * seeds_parse()
+ * -------------
+ * reads the seed sets from `path`, comments start with '%'
+ * or '#'. With `one_set` the whole file is one set with a
+ * "node [weight]" pair per line, otherwise every line is a
+ * set of "node[:weight]" tokens. Missing weights are 1.
+ * Nodes are file ids as in the graph and delta files, from
+ * 1 to `nodes` (stored minus 1). Other ids, malformed
+ * tokens and a third token on a "node [weight]" line are
+ * an error
+ */
+seed_sets *seeds_parse(const char *path, int nodes, bool one_set);
+
+void seeds_destroy(seed_sets *s);
+
+/**
+ * seeds_relabel()
+ * ---------------
+ * maps the seed nodes to the ids of a reordered graph
+ * (perm[new] = old, see graph_reorder())
+ */
+void seeds_relabel(seed_sets *s, const int *perm, int nodes);
+
+/**
+ * seeds_vector()
+ * --------------
+ * dense teleport vector of the set `set` (sum 1)
+ */
+double *seeds_vector(const seed_sets *s, int set, int nodes);
+
+/**
+ * pagerank_batch()
+ * ----------------
+ * personalized pagerank of the `count` seed sets starting
+ * at `first`, Jacobi iteration with every vector stopped
+ * together when the largest L1 error is below eps.
+ * Returns the interleaved vectors X[node * count + b]
+ */
+double *pagerank_batch(graph *grph, double dumping, double eps, int max_iter, thread_pool *pool, const seed_sets *s, int first, int count, int *iter_count, double *error);
+
+/**
+ * pagerank_batch_column()
+ * -----------------------
+ * copy of the vector b out of the interleaved batch
+ */
+double *pagerank_batch_column(const double *X, int nodes, int count, int b);
+
+#endif
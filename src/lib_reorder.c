@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "lib_reorder.h"
+#include "lib_graph.h"
+#include "lib_pagerank.h"
+#include "lib_supp.h"
+#include "lib_threads.h"
+
+/**
+ * relabel job shared by the parallel for body
+ */
+typedef struct reorder_attr{
+    const graph *src;
+    graph       *dst;
+    const int   *perm;      //new -> old
+    const int   *inv;       //old -> new
+}reorder_attr;
+
+/**
+ * degree_order()
+ * --------------
+ * counting sort of the nodes by degree[], stable on the
+ * node id, ascending or descending
+ */
+static void degree_order(const int *degree, int nodes, int *order, bool descending){
+    int max_degree = 0;
+    for(int v = 0; v<nodes; v++)
+        if(degree[v] > max_degree)
+            max_degree = degree[v];
+
+    int *count = xcalloc(max_degree + 2, sizeof(int), HERE);
+
+    for(int v = 0; v<nodes; v++){
+        const int d = descending ? max_degree - degree[v] : degree[v];
+        count[d + 1]++;
+    }
+    for(int d = 0; d<=max_degree; d++)
+        count[d + 1] += count[d];
+
+    for(int v = 0; v<nodes; v++){
+        const int d = descending ? max_degree - degree[v] : degree[v];
+        order[count[d]++] = v;
+    }
+
+    free(count);
+}
+
+static int cmp_key(const void *a, const void *b){
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * rcm_order()
+ * -----------
+ * reverse Cuthill-McKee on the symmetrized graph (in and
+ * out lists). Each connected component is visited in BFS
+ * order starting from its lowest degree node, the newly
+ * reached neighbours of a node are queued by ascending
+ * degree. The final order is the BFS order reversed
+ */
+static void rcm_order(const graph *g, const int *degree, int *order){
+    const int nodes = g->nodes;
+
+    //out lists (transpose of the CSR in lists)
+    edge_t *out_offsets = xmalloc((nodes + 1) * sizeof(edge_t), HERE);
+    int *out_targets    = xmalloc(((size_t)g->edges + 1) * sizeof(int), HERE);
+    edge_t *cursor      = xmalloc((nodes + 1) * sizeof(edge_t), HERE);
+
+    out_offsets[0] = 0;
+    for(int v = 0; v<nodes; v++)
+        out_offsets[v+1] = out_offsets[v] + g->out[v];
+    memcpy(cursor, out_offsets, (nodes + 1) * sizeof(edge_t));
+
+    for(int v = 0; v<nodes; v++)
+        for(edge_t j = g->offsets[v]; j<g->offsets[v+1]; j++)
+            out_targets[cursor[g->sources[j]]++] = v;
+
+    free(cursor);
+
+    int      *start     = xmalloc(nodes * sizeof(int), HERE);
+    bool     *visited   = xcalloc(nodes, sizeof(bool), HERE);
+    uint64_t *keys      = NULL;
+    int      keys_size  = 0;
+    int      head = 0, tail = 0;
+
+    degree_order(degree, nodes, start, false);
+
+    for(int s = 0; s<nodes; s++){
+        if(visited[start[s]])
+            continue;
+
+        visited[start[s]]   = true;
+        order[tail++]       = start[s];
+
+        while(head < tail){
+            const int v     = order[head++];
+            const int first = tail;
+
+            for(edge_t j = g->offsets[v]; j<g->offsets[v+1]; j++){
+                const int u = g->sources[j];
+                if(!visited[u]){
+                    visited[u]      = true;
+                    order[tail++]   = u;
+                }
+            }
+            for(edge_t j = out_offsets[v]; j<out_offsets[v+1]; j++){
+                const int u = out_targets[j];
+                if(!visited[u]){
+                    visited[u]      = true;
+                    order[tail++]   = u;
+                }
+            }
+
+            //sort the new ones by (degree, id)
+            const int length = tail - first;
+            if(length > 1){
+                if(length > keys_size){
+                    keys_size   = length;
+                    keys        = xrealloc(keys, keys_size * sizeof(uint64_t), HERE);
+                }
+                for(int i = 0; i<length; i++)
+                    keys[i] = ((uint64_t)degree[order[first + i]] << 32) | (uint32_t)order[first + i];
+
+                qsort(keys, length, sizeof(uint64_t), cmp_key);
+
+                for(int i = 0; i<length; i++)
+                    order[first + i] = (int)(keys[i] & 0xFFFFFFFFu);
+            }
+        }
+    }
+
+    //reverse
+    for(int i = 0, j = nodes - 1; i<j; i++, j--){
+        int tmp     = order[i];
+        order[i]    = order[j];
+        order[j]    = tmp;
+    }
+
+    free(keys);
+    free(visited);
+    free(start);
+    free(out_targets);
+    free(out_offsets);
+}
+
+/**
+ * reorder_relabel_body()
+ * ----------------------
+ * parallel for body: copies the in-list of every new node
+ * in [start, end) with the sources relabeled, and sorts it
+ * again (new ids are not monotone in the old ones)
+ */
+static void reorder_relabel_body(void *attr, int start, int end){
+    reorder_attr *arg = (reorder_attr *)attr;
+    const graph  *src = arg->src;
+    graph        *dst = arg->dst;
+    int *tmp        = NULL;
+    edge_t tmp_size = 0;
+
+    for(int v = start; v<end; v++){
+        const int old       = arg->perm[v];
+        const edge_t length = src->offsets[old+1] - src->offsets[old];
+        const int *in       = src->sources + src->offsets[old];
+        int *list           = dst->sources + dst->offsets[v];
+
+        dst->out[v] = src->out[old];
+
+        for(edge_t j = 0; j<length; j++)
+            list[j] = arg->inv[in[j]];
+
+        if(length <= SORT_SMALL){
+            insertion_sort(list, (int)length);
+        }
+        else{
+            if(length > tmp_size){
+                tmp_size    = length;
+                tmp         = xrealloc(tmp, tmp_size * sizeof(int), HERE);
+            }
+            radix_sort(list, tmp, length, dst->nodes - 1);
+        }
+    }
+
+    free(tmp);
+}
+
+graph *graph_reorder(graph *g, int mode, thread_pool *pool, int **perm, bool take_time){
+    struct timeval start, order_end, end;
+    const int nodes = g->nodes;
+
+    xgettimeofday(&start, take_time, HERE);
+
+    int *degree = xmalloc(nodes * sizeof(int), HERE);
+    int *order  = xmalloc(nodes * sizeof(int), HERE);
+    int *inv    = xmalloc(nodes * sizeof(int), HERE);
+
+    for(int v = 0; v<nodes; v++)
+        degree[v] = (int)(g->offsets[v+1] - g->offsets[v]) + g->out[v];
+
+    if(mode == REORDER_RCM)
+        rcm_order(g, degree, order);
+    else if(mode == REORDER_DEGREE)
+        degree_order(degree, nodes, order, true);
+    else
+        for(int v = 0; v<nodes; v++)
+            order[v] = v;
+
+    for(int v = 0; v<nodes; v++)
+        inv[order[v]] = v;
+
+    xgettimeofday(&order_end, take_time, HERE);
+
+    /**
+     * relabeled graph: offsets are the prefix sum of the
+     * permuted in-degrees, the lists are copied in parallel
+     */
+    graph *r    = graph_alloc(nodes, g->edges);
+    r->sources  = xmalloc(((size_t)g->edges + 1) * sizeof(int), HERE);
+    r->dead_count = g->dead_count;
+
+    r->offsets[0] = 0;
+    for(int v = 0; v<nodes; v++)
+        r->offsets[v+1] = r->offsets[v] + (g->offsets[order[v]+1] - g->offsets[order[v]]);
+
+    reorder_attr attr;
+    attr.src    = g;
+    attr.dst    = r;
+    attr.perm   = order;
+    attr.inv    = inv;
+    pool_parallel_for(pool, 0, nodes, PAGERANK_CHUNK, reorder_relabel_body, &attr);
+
+    free(inv);
+    free(degree);
+
+    xgettimeofday(&end, take_time, HERE);
+
+    if(take_time){
+        fprintf(stderr,"\n======\tReorder Stats\t======\n");
+        fprintf(stderr,"order time\t\t%.6f sec\n",exctract_time(start,order_end,take_time));
+        fprintf(stderr,"relabel time\t\t%.6f sec\n",exctract_time(order_end,end,take_time));
+        fprintf(stderr,"total time\t\t%.6f sec\n",exctract_time(start,end,take_time));
+    }
+
+    *perm = order;
+    return r;
+}
+
+double *reorder_ranks(double *ranks, const int *perm, int nodes){
+    double *orig = xmalloc(nodes * sizeof(double), HERE);
+
+    for(int v = 0; v<nodes; v++)
+        orig[perm[v]] = ranks[v];
+
+    free(ranks);
+    return orig;
+}
@@ -0,0 +1,49 @@
+#ifndef LIBRORD
+#define LIBRORD
+
+#include <stdbool.h>
+
+#include "lib_graph.h"
+#include "lib_threads.h"
+
+/**
+ * ### Vertex Reordering
+ * ---------------------
+ * Optional pass between graph_parse() and pagerank(): the
+ * nodes are relabeled so that the Y[src] reads of the X
+ * phase hit nearby addresses.
+ *
+ *  REORDER_DEGREE: nodes sorted by total degree (in + out),
+ *                  descending: the hubs, read by most of
+ *                  the lists, share a few cache lines
+ *  REORDER_RCM:    reverse Cuthill-McKee on the symmetrized
+ *                  graph: BFS order from low degree nodes,
+ *                  neighbours of a node get close labels
+ *
+ * perm[new] = old. Ranks computed on the reordered graph
+ * are mapped back with reorder_ranks().
+ */
+
+#define REORDER_NONE    0
+#define REORDER_DEGREE  1
+#define REORDER_RCM     2
+
+/**
+ * graph_reorder()
+ * ---------------
+ * returns a new graph with the nodes relabeled by `mode`
+ * (adjacency lists still sorted and without duplicates)
+ * and the permutation in *perm. The input graph is left
+ * untouched
+ */
+graph *graph_reorder(graph *g, int mode, thread_pool *pool, int **perm, bool take_time);
+
+/**
+ * reorder_ranks()
+ * ---------------
+ * ranks of the reordered graph -> ranks in the original
+ * IDs (new vector, `ranks` is freed)
+ */
+double *reorder_ranks(double *ranks, const int *perm, int nodes);
+
+#endif
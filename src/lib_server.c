@@ -0,0 +1,476 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "lib_server.h"
+#include "lib_reorder.h"
+#include "lib_supp.h"
+
+/**
+ * background computation parameters
+ */
+typedef struct server_job{
+    rank_server *srv;
+    double      dumping;
+    double      epsilon;
+    int         max_iter;
+}server_job;
+
+/**
+ * reply buffer, grown on demand (TOP with a large k)
+ */
+typedef struct server_reply{
+    char    *data;
+    size_t  length;
+    size_t  size;
+}server_reply;
+
+/**
+ * per connection buffers: input (requests may arrive split
+ * across reads, or several in one read) and the replies not
+ * sent yet, out.data[sent, out.length). The socket is non
+ * blocking: a client that doesn't read only stalls itself
+ */
+typedef struct server_client{
+    int             fd;
+    int             length;
+    char            buffer[SERVER_LINE];
+    server_reply    out;
+    size_t          sent;
+    bool            closing;    //close once the replies are sent
+}server_client;
+
+static double server_clock(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+/**
+ * server_compute()
+ * ----------------
+ * one full pagerank run: ranks mapped back to the original
+ * ids and sorted (descending rank, ascending id), then
+ * published under the lock. Only one job runs at a time,
+ * so it has the pool to itself
+ */
+static void *server_compute(void *attr){
+    server_job  *job = (server_job *)attr;
+    rank_server *srv = job->srv;
+    int iterations = 0;
+
+    double *ranks = pagerank(srv->g, job->dumping, job->epsilon, job->max_iter, srv->pool, &(srv->opts), &iterations);
+    if(srv->perm != NULL)
+        ranks = reorder_ranks(ranks, srv->perm, srv->g->nodes);
+
+    int *order = find_K_Max(ranks, srv->g->nodes, srv->g->nodes, srv->pool);
+
+    xpthread_mutex_lock(&(srv->mux), HERE);
+        free(srv->ranks);
+        free(srv->order);
+        srv->ranks      = ranks;
+        srv->order      = order;
+        srv->iterations = iterations;
+        srv->error      = srv->opts.error;
+        srv->current_d  = job->dumping;
+        srv->version   += 1;
+        srv->computing  = false;
+        xpthread_cond_broadcast(&(srv->done), HERE);
+    xpthread_mutex_unlock(&(srv->mux), HERE);
+
+    free(job);
+    return NULL;
+}
+
+//caller holds the lock
+static bool server_start_job(rank_server *srv, double dumping, double epsilon, int max_iter){
+    if(srv->computing)
+        return false;
+
+    server_job *job = xmalloc(sizeof(server_job), HERE);
+    job->srv        = srv;
+    job->dumping    = dumping;
+    job->epsilon    = epsilon;
+    job->max_iter   = max_iter;
+
+    pthread_t tid;
+    srv->computing = true;
+    xpthread_create(&tid, server_compute, job, HERE);
+    pthread_detach(tid);
+
+    return true;
+}
+
+/**
+ * server_flush()
+ * --------------
+ * sends the pending replies of a connection as far as the
+ * socket takes them. Returns false if the connection is
+ * broken
+ */
+static bool server_flush(server_client *c){
+    while(c->sent < c->out.length){
+        ssize_t n = send(c->fd, c->out.data + c->sent, c->out.length - c->sent, MSG_NOSIGNAL);
+        if(n < 0){
+            if(errno == EINTR)
+                continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        c->sent += n;
+    }
+
+    //all sent: a buffer grown by a large TOP goes back to its size
+    c->out.length   = 0;
+    c->sent         = 0;
+    if(c->out.size > SERVER_REPLY){
+        c->out.size = SERVER_REPLY;
+        c->out.data = xrealloc(c->out.data, c->out.size, HERE);
+    }
+    return true;
+}
+
+__attribute__((format(printf, 2, 3)))
+static void reply_printf(server_reply *r, const char *fmt, ...){
+    va_list ap;
+
+    for(;;){
+        va_start(ap, fmt);
+        int n = vsnprintf(r->data + r->length, r->size - r->length, fmt, ap);
+        va_end(ap);
+
+        if(n < 0)
+            error("[vsnprintf] server reply", HERE);
+        if(r->length + n < r->size){
+            r->length += n;
+            return;
+        }
+        r->size = 2 * (r->size + n);
+        r->data = xrealloc(r->data, r->size, HERE);
+    }
+}
+
+//nothing but blanks left on the request line
+static bool line_end(const char *p){
+    return p[strspn(p, " \t\r")] == '\0';
+}
+
+/**
+ * recompute_params()
+ * ------------------
+ * the optional "d [e [m]]" of RECOMPUTE: every token has
+ * to be a whole number and nothing may follow m
+ */
+static bool recompute_params(const char *args, double *d, double *e, int *m){
+    const char *p = args;
+    char *end;
+
+    for(int i = 0; !line_end(p); i++){
+        p += strspn(p, " \t\r");
+
+        if(i == 0)
+            *d = strtod(p, &end);
+        else if(i == 1)
+            *e = strtod(p, &end);
+        else if(i == 2){
+            errno = 0;
+            long v = strtol(p, &end, 10);
+            if(errno != 0 || v > INT_MAX || v < INT_MIN)
+                return false;
+            *m = (int)v;
+        }
+        else
+            return false;
+
+        if(end == p || (*end != '\0' && strchr(" \t\r", *end) == NULL))
+            return false;
+        p = end;
+    }
+    return true;
+}
+
+/**
+ * server_request()
+ * ----------------
+ * parses one request line and appends the reply. Returns
+ * false when the connection has to be closed (QUIT,
+ * SHUTDOWN), *shutdown is set by SHUTDOWN. Arguments
+ * followed by anything else are an error
+ */
+static bool server_request(rank_server *srv, char *line, server_reply *reply, bool *shutdown){
+    char cmd[16];
+    int consumed = 0;
+
+    if(sscanf(line, "%15s%n", cmd, &consumed) != 1){
+        reply_printf(reply, "ERR empty request\n");
+        return true;
+    }
+    const char *args = line + consumed;
+
+    xpthread_mutex_lock(&(srv->mux), HERE);
+
+    bool keep = true;
+
+    if(strcmp(cmd, "RANK") == 0){
+        long node;
+        int used = 0;
+        if(sscanf(args, "%ld%n", &node, &used) != 1 || !line_end(args + used) || node < 0 || node >= srv->g->nodes)
+            reply_printf(reply, "ERR bad node\n");
+        else
+            reply_printf(reply, "OK %.10e\n", srv->ranks[node]);
+    }
+    else if(strcmp(cmd, "TOP") == 0){
+        long k;
+        int used = 0;
+        if(sscanf(args, "%ld%n", &k, &used) != 1 || !line_end(args + used) || k < 0)
+            reply_printf(reply, "ERR bad k\n");
+        else{
+            if(k > srv->g->nodes)
+                k = srv->g->nodes;
+            reply_printf(reply, "OK %ld\n", k);
+            for(long i = 0; i<k; i++)
+                reply_printf(reply, "%d %.10e\n", srv->order[i], srv->ranks[srv->order[i]]);
+        }
+    }
+    else if(strcmp(cmd, "RECOMPUTE") == 0){
+        double d = srv->dumping, e = srv->epsilon;
+        int m = srv->max_iter;
+
+        if(!recompute_params(args, &d, &e, &m))
+            reply_printf(reply, "ERR bad parameters\n");
+        else if(!(d > 0.0 && d < 1.0) || !(e > 0.0) || m < 1)
+            reply_printf(reply, "ERR bad parameters\n");
+        else if(server_start_job(srv, d, e, m))
+            reply_printf(reply, "OK %d\n", srv->version + 1);
+        else
+            reply_printf(reply, "ERR busy\n");
+    }
+    else if(strcmp(cmd, "STATUS") == 0){
+        reply_printf(reply, "OK %d %d %e %g %s\n", srv->version, srv->iterations, srv->error,
+            srv->current_d, srv->computing ? "computing" : "idle");
+    }
+    else if(strcmp(cmd, "STATS") == 0){
+        reply_printf(reply, "OK %ld %.1f %.1f\n", srv->requests,
+            (srv->requests > 0) ? srv->latency_sum / srv->requests : 0.0, srv->latency_max);
+    }
+    else if(strcmp(cmd, "QUIT") == 0){
+        keep = false;
+    }
+    else if(strcmp(cmd, "SHUTDOWN") == 0){
+        reply_printf(reply, "OK\n");
+        *shutdown   = true;
+        keep        = false;
+    }
+    else
+        reply_printf(reply, "ERR unknown command\n");
+
+    xpthread_mutex_unlock(&(srv->mux), HERE);
+
+    return keep;
+}
+
+/**
+ * server_input()
+ * --------------
+ * reads what is available on a connection. Returns false
+ * if the connection is over
+ */
+static bool server_input(server_client *c){
+    ssize_t n = read(c->fd, c->buffer + c->length, SERVER_LINE - c->length);
+    if(n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        return true;
+    if(n <= 0)
+        return false;
+
+    c->length += n;
+    return true;
+}
+
+/**
+ * server_process()
+ * ----------------
+ * queues the replies of the complete lines read so far,
+ * until SERVER_REPLY bytes are waiting (one large TOP at a
+ * time, the other clients are served in between) or a QUIT
+ * or SHUTDOWN closes the connection
+ */
+static void server_process(rank_server *srv, server_client *c, bool *shutdown){
+    char *start = c->buffer;
+    char *eol;
+
+    while(!c->closing && c->out.length < SERVER_REPLY &&
+        (eol = memchr(start, '\n', c->length - (start - c->buffer))) != NULL){
+        *eol = '\0';
+        const double t0 = server_clock();
+
+        if(!server_request(srv, start, &(c->out), shutdown))
+            c->closing = true;
+
+        const double us = server_clock() - t0;
+
+        xpthread_mutex_lock(&(srv->mux), HERE);
+            srv->requests++;
+            srv->latency_sum += us;
+            if(us > srv->latency_max)
+                srv->latency_max = us;
+        xpthread_mutex_unlock(&(srv->mux), HERE);
+
+        if(srv->log != NULL)
+            fprintf(srv->log, "[serve] %s\t%.1f us\n", start, us);
+
+        start = eol + 1;
+    }
+
+    //keep the lines left at the begin of the buffer
+    c->length -= start - c->buffer;
+    memmove(c->buffer, start, c->length);
+
+    if(!c->closing && c->length == SERVER_LINE && memchr(c->buffer, '\n', c->length) == NULL){
+        reply_printf(&(c->out), "ERR line too long\n");
+        c->closing = true;
+    }
+}
+
+void server_run(rank_server *srv, const char *path){
+    struct sockaddr_un addr;
+
+    if(strlen(path) >= sizeof(addr.sun_path))
+        error("[server_run] socket path too long", HERE);
+
+    xpthread_mutex_init(&(srv->mux), HERE);
+    xpthread_cond_init(&(srv->done), HERE);
+    srv->ranks          = NULL;
+    srv->order          = NULL;
+    srv->version        = 0;
+    srv->iterations     = 0;
+    srv->error          = 0.0;
+    srv->current_d      = srv->dumping;
+    srv->computing      = false;
+    srv->requests       = 0;
+    srv->latency_sum    = 0.0;
+    srv->latency_max    = 0.0;
+
+    //first vector before accepting connections
+    xpthread_mutex_lock(&(srv->mux), HERE);
+        server_start_job(srv, srv->dumping, srv->epsilon, srv->max_iter);
+        while(srv->computing)
+            xpthread_cond_wait(&(srv->done), &(srv->mux), HERE);
+    xpthread_mutex_unlock(&(srv->mux), HERE);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listen_fd < 0)
+        error("[socket]", HERE);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    if(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        error("[bind]", HERE);
+    if(listen(listen_fd, SERVER_CLIENTS) != 0)
+        error("[listen]", HERE);
+
+    fprintf(stderr, "[serve] listening on %s (%d nodes)\n", path, srv->g->nodes);
+
+    struct pollfd   fds[SERVER_CLIENTS + 1];
+    server_client   *clients = xcalloc(SERVER_CLIENTS, sizeof(server_client), HERE);
+    int count = 0;
+    bool shutdown = false;
+
+    while(!shutdown){
+        /**
+         * a connection with replies pending waits to be
+         * writable and its next requests stay unread
+         */
+        fds[0].fd       = listen_fd;
+        fds[0].events   = (count < SERVER_CLIENTS) ? POLLIN : 0;
+        for(int i = 0; i<count; i++){
+            fds[i + 1].fd       = clients[i].fd;
+            fds[i + 1].events   = (clients[i].out.length > 0 || clients[i].closing) ? POLLOUT : POLLIN;
+        }
+
+        if(poll(fds, count + 1, -1) < 0){
+            if(errno == EINTR)
+                continue;
+            error("[poll]", HERE);
+        }
+
+        //connections first: the client slots are compacted below
+        for(int i = count - 1; i>=0 && !shutdown; i--){
+            if(fds[i + 1].revents == 0)
+                continue;
+
+            server_client *c = &clients[i];
+            bool keep = true;
+
+            if(fds[i + 1].events == POLLIN)
+                keep = server_input(c);
+
+            //answer while the replies leave at once
+            while(keep){
+                server_process(srv, c, &shutdown);
+                keep = server_flush(c) && !(c->closing && c->out.length == 0);
+                if(c->out.length > 0 || c->closing || memchr(c->buffer, '\n', c->length) == NULL)
+                    break;
+            }
+
+            if(!keep){
+                close(c->fd);
+                free(c->out.data);
+                clients[i] = clients[--count];
+            }
+        }
+
+        if(!shutdown && (fds[0].revents & POLLIN)){
+            int fd = accept(listen_fd, NULL, NULL);
+            if(fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0){
+                close(fd);
+                fd = -1;
+            }
+            if(fd >= 0){
+                server_client *c = &clients[count++];
+                c->fd           = fd;
+                c->length       = 0;
+                c->sent         = 0;
+                c->closing      = false;
+                c->out.size     = SERVER_REPLY;
+                c->out.length   = 0;
+                c->out.data     = xmalloc(c->out.size, HERE);
+            }
+        }
+    }
+
+    //last replies (the OK of SHUTDOWN): what the sockets take now
+    for(int i = 0; i<count; i++){
+        server_flush(&clients[i]);
+        close(clients[i].fd);
+        free(clients[i].out.data);
+    }
+    close(listen_fd);
+    unlink(path);
+
+    //a computation still running owns the pool and the graph
+    xpthread_mutex_lock(&(srv->mux), HERE);
+        while(srv->computing)
+            xpthread_cond_wait(&(srv->done), &(srv->mux), HERE);
+    xpthread_mutex_unlock(&(srv->mux), HERE);
+
+    fprintf(stderr, "[serve] %ld requests, mean %.1f us, max %.1f us\n", srv->requests,
+        (srv->requests > 0) ? srv->latency_sum / srv->requests : 0.0, srv->latency_max);
+
+    free(clients);
+    free(srv->ranks);
+    free(srv->order);
+    xpthread_cond_destroy(&(srv->done), HERE);
+    xpthread_mutex_destroy(&(srv->mux), HERE);
+}
@@ -0,0 +1,85 @@
+#ifndef LIBSRV
+#define LIBSRV
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "lib_graph.h"
+#include "lib_threads.h"
+#include "lib_pagerank.h"
+
+/**
+ * ### Rank Server
+ * ---------------
+ * Keeps the parsed graph and the latest rank vector in
+ * memory and answers queries on a UNIX domain socket, one
+ * text line per request:
+ *
+ *      RANK <node>             OK <rank>
+ *      TOP <k>                 OK <k>, then k lines "<node> <rank>"
+ *      RECOMPUTE [d [e [m]]]   OK <version>: computation started
+ *      STATUS                  OK <version> <iterations> <error> <d> idle|computing
+ *      STATS                   OK <requests> <mean us> <max us>
+ *      QUIT                    closes the connection
+ *      SHUTDOWN                stops the server
+ *
+ * errors are answered with "ERR <reason>", also when the
+ * arguments are followed by anything else. Node ids are the
+ * 0-based ids printed by printStats().
+ *
+ * RECOMPUTE runs pagerank() on a background thread (one at
+ * a time): queries keep being served from the previous
+ * vector, the new one replaces it when complete (version
+ * + 1). The order of the nodes by rank is computed with
+ * it, so TOP costs O(k).
+ *
+ * Connections are non blocking: replies are queued on the
+ * connection and sent when its socket is writable, and its
+ * next requests are read only after that. A client that
+ * doesn't read its replies never stalls the others.
+ *
+ * Every request is timed from the complete line to the
+ * queued reply, logged on `log` and summed up by STATS.
+ */
+
+#ifndef SERVER_CLIENTS
+#define SERVER_CLIENTS 64
+#endif
+
+#define SERVER_LINE 256     //longest request line
+#define SERVER_REPLY 4096   //initial reply buffer of a connection
+
+typedef struct rank_server{
+    graph           *g;
+    thread_pool     *pool;
+    const int       *perm;          //reordered graph: perm[new] = old, NULL = none
+    pagerank_opts   opts;
+    double          dumping;
+    double          epsilon;
+    int             max_iter;
+    FILE            *log;           //per request latency, NULL = none
+
+    pthread_mutex_t mux;            //protects the fields below
+    pthread_cond_t  done;           //signaled when a computation ends
+    double          *ranks;         //original ids
+    int             *order;         //node ids by rank, descending
+    int             version;
+    int             iterations;
+    double          error;
+    double          current_d;
+    bool            computing;
+
+    long            requests;
+    double          latency_sum;    //us
+    double          latency_max;
+}rank_server;
+
+/**
+ * server_run()
+ * ------------
+ * computes the first vector, then serves `path` until a
+ * SHUTDOWN request. The socket file is removed on exit
+ */
+void server_run(rank_server *srv, const char *path);
+
+#endif
@@ -53,6 +53,13 @@ void *xreallocarray(void *ptr, size_t nmemb, size_t size, char *file, int line){
     return ret;
 }
 
+void *xaligned_alloc(size_t alignment, size_t size, char *file, int line){
+    void *ret = NULL;
+    if(posix_memalign(&ret,alignment,size) != 0)
+        error("[Bad posix_memalign]",file,line);
+    return ret;
+}
+
 
 FILE *xfopen(const char *path,const char *mode,char *file,int line){
     FILE *f=fopen(path,mode);
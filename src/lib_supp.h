@@ -27,6 +27,8 @@ void *xrealloc(void *ptr,size_t size,char *file,int line);
 
 void *xreallocarray(void *ptr, size_t nmemb, size_t size, char *file, int line);
 
+void *xaligned_alloc(size_t alignment, size_t size, char *file, int line);
+
 /**
  * ### File Streams
  * ------------
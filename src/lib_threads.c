@@ -1,31 +1,217 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdatomic.h>
-/*
-Implementation of single producer multiple consumer lock free
-bounded buffer. For a single producer single consumer bounded 
-buffer i can use atomic variables to control the state of the
-buffer (head and tail) and use custom functions to handle 
-insertion and extraction of an element from the buffer.
-I can allocate the buffer on the heap or on the stack, since 
-the size is bounded.
-
-Must think of something different for multiple producer single 
-consumer, 
-
-synchronize the multiple end of the queue using spinlock (implemented
-with atomic variables)
-*/
-
-#define BUFFER_SIZE 16 // Must be a power of 2 for simplicity
-
-typedef struct {
-    int origin;
-    int destination;
-} node;
-
-typedef struct {
-    atomic_size_t head;   // Index of the head (consumer)
-    atomic_size_t tail;   // Index of the tail (producer)
-    int buffer[BUFFER_SIZE]; // Ring buffer storage
-} LockFreeBuffer;
\ No newline at end of file
+#include <pthread.h>
+
+#include "lib_threads.h"
+#include "lib_supp.h"
+
+#define HERE __FILE__,__LINE__
+
+#define POOL_QUEUE_DEF 64
+
+static void *pool_worker(void *attr){
+    thread_pool *pool = (thread_pool *)attr;
+    pool_task task;
+
+    xpthread_mutex_lock(&(pool->mux),HERE);
+    while(true){
+        while(pool->q_count == 0 && pool->exit == false)
+            xpthread_cond_wait(&(pool->work_cond),&(pool->mux),HERE);
+
+        if(pool->q_count == 0 && pool->exit == true)
+            break;
+
+        task = pool->queue[pool->q_head];
+        pool->q_head   = (pool->q_head + 1) % pool->q_size;
+        pool->q_count -= 1;
+
+        xpthread_mutex_unlock(&(pool->mux),HERE);
+            task.routine(task.arg);
+        xpthread_mutex_lock(&(pool->mux),HERE);
+
+        pool->pending -= 1;
+        if(pool->pending == 0)
+            xpthread_cond_broadcast(&(pool->done_cond),HERE);
+    }
+    xpthread_mutex_unlock(&(pool->mux),HERE);
+
+    return NULL;
+}
+
+thread_pool *pool_create(int size){
+    if(size < 1)
+        error("[pool_create] thread count must be positive",HERE);
+
+    thread_pool *pool = xmalloc(sizeof(thread_pool),HERE);
+    pool->size      = size;
+    pool->tid       = xmalloc(size * sizeof(pthread_t),HERE);
+    pool->q_size    = POOL_QUEUE_DEF;
+    pool->queue     = xmalloc(pool->q_size * sizeof(pool_task),HERE);
+    pool->q_head    = 0;
+    pool->q_count   = 0;
+    pool->pending   = 0;
+    pool->exit      = false;
+    xpthread_mutex_init(&(pool->mux),HERE);
+    xpthread_cond_init(&(pool->work_cond),HERE);
+    xpthread_cond_init(&(pool->done_cond),HERE);
+
+    for(int i = 0; i<size; i++)
+        xpthread_create(&(pool->tid[i]),pool_worker,pool,HERE);
+
+    return pool;
+}
+
+void pool_destroy(thread_pool *pool){
+    xpthread_mutex_lock(&(pool->mux),HERE);
+        pool->exit = true;
+        xpthread_cond_broadcast(&(pool->work_cond),HERE);
+    xpthread_mutex_unlock(&(pool->mux),HERE);
+
+    for(int i = 0; i<pool->size; i++)
+        xpthread_join(pool->tid[i],NULL,HERE);
+
+    xpthread_mutex_destroy(&(pool->mux),HERE);
+    xpthread_cond_destroy(&(pool->work_cond),HERE);
+    xpthread_cond_destroy(&(pool->done_cond),HERE);
+    free(pool->queue);
+    free(pool->tid);
+    free(pool);
+}
+
+void pool_submit(thread_pool *pool, void *(*routine)(void *), void *arg){
+    xpthread_mutex_lock(&(pool->mux),HERE);
+
+        //grow the circular queue (unrolling it from the head)
+        if(pool->q_count == pool->q_size){
+            pool_task *queue = xmalloc(2 * pool->q_size * sizeof(pool_task),HERE);
+            for(int i = 0; i<pool->q_count; i++)
+                queue[i] = pool->queue[(pool->q_head + i) % pool->q_size];
+            free(pool->queue);
+            pool->queue     = queue;
+            pool->q_head    = 0;
+            pool->q_size   *= 2;
+        }
+
+        pool->queue[(pool->q_head + pool->q_count) % pool->q_size].routine = routine;
+        pool->queue[(pool->q_head + pool->q_count) % pool->q_size].arg     = arg;
+        pool->q_count += 1;
+        pool->pending += 1;
+
+        xpthread_cond_signal(&(pool->work_cond),HERE);
+    xpthread_mutex_unlock(&(pool->mux),HERE);
+}
+
+void pool_wait(thread_pool *pool){
+    xpthread_mutex_lock(&(pool->mux),HERE);
+        while(pool->pending > 0)
+            xpthread_cond_wait(&(pool->done_cond),&(pool->mux),HERE);
+    xpthread_mutex_unlock(&(pool->mux),HERE);
+}
+
+typedef struct pool_for_attr{
+    void        (*body)(void *, int, int);
+    void        *arg;
+    int         end;
+    int         chunk;
+    atomic_int  next;
+}pool_for_attr;
+
+static void *pool_for_routine(void *attr){
+    pool_for_attr *loop = (pool_for_attr *)attr;
+    int start;
+
+    while((start = atomic_fetch_add_explicit(&(loop->next), loop->chunk, memory_order_relaxed)) < loop->end){
+        int stop = (loop->end - start > loop->chunk) ? start + loop->chunk : loop->end;
+        loop->body(loop->arg, start, stop);
+    }
+    return NULL;
+}
+
+void pool_parallel_for(thread_pool *pool, int begin, int end, int chunk, void (*body)(void *, int, int), void *arg){
+    if(begin >= end)
+        return;
+
+    pool_for_attr loop;
+    loop.body   = body;
+    loop.arg    = arg;
+    loop.end    = end;
+    loop.chunk  = chunk > 0 ? chunk : 1;
+    atomic_init(&(loop.next), begin);
+
+    int tasks = (end - begin + loop.chunk - 1) / loop.chunk;
+    if(tasks > pool->size)
+        tasks = pool->size;
+
+    for(int i = 0; i<tasks; i++)
+        pool_submit(pool, pool_for_routine, &loop);
+    pool_wait(pool);
+}
+
+static inline void cpu_relax(void){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+void barrier_init(spin_barrier *b, int size, int spin){
+    atomic_init(&(b->count), 0);
+    atomic_init(&(b->sense), 0);
+    atomic_init(&(b->sleepers), 0);
+    b->size = size;
+    b->spin = spin;
+    xpthread_mutex_init(&(b->mux),HERE);
+    xpthread_cond_init(&(b->cond),HERE);
+}
+
+void barrier_destroy(spin_barrier *b){
+    xpthread_mutex_destroy(&(b->mux),HERE);
+    xpthread_cond_destroy(&(b->cond),HERE);
+}
+
+bool barrier_enter(spin_barrier *b, int *local_sense){
+    const int sense = !(*local_sense);
+    *local_sense = sense;
+
+    if(atomic_fetch_add(&(b->count), 1) == b->size - 1){
+        atomic_store_explicit(&(b->count), 0, memory_order_relaxed);
+        return true;
+    }
+
+    for(int i = 0; i<b->spin; i++){
+        if(atomic_load_explicit(&(b->sense), memory_order_acquire) == sense)
+            return false;
+        cpu_relax();
+    }
+
+    /**
+     * park: sleepers is raised before checking the sense,
+     * barrier_release stores the sense before reading
+     * sleepers, so at least one side sees the other
+     */
+    xpthread_mutex_lock(&(b->mux),HERE);
+        atomic_fetch_add(&(b->sleepers), 1);
+        while(atomic_load(&(b->sense)) != sense)
+            xpthread_cond_wait(&(b->cond),&(b->mux),HERE);
+        atomic_fetch_sub(&(b->sleepers), 1);
+    xpthread_mutex_unlock(&(b->mux),HERE);
+
+    return false;
+}
+
+void barrier_release(spin_barrier *b, int *local_sense){
+    atomic_store(&(b->sense), *local_sense);
+
+    if(atomic_load(&(b->sleepers)) > 0){
+        xpthread_mutex_lock(&(b->mux),HERE);
+            xpthread_cond_broadcast(&(b->cond),HERE);
+        xpthread_mutex_unlock(&(b->mux),HERE);
+    }
+}
+
+void barrier_wait(spin_barrier *b, int *local_sense){
+    if(barrier_enter(b, local_sense))
+        barrier_release(b, local_sense);
+}
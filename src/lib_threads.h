@@ -0,0 +1,106 @@
+#ifndef LIBTHRD
+#define LIBTHRD
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * ### Thread Pool
+ * ---------------
+ * Persistent group of worker threads reused by every
+ * parallel phase (parsing, dedup, pagerank), so threads
+ * are created once per process instead of once per phase.
+ *
+ * Tasks have the same signature of a pthread start routine
+ * (they must return, never call pthread_exit).
+ *
+ * IMPORTANT: tasks that wait for each other (barriers,
+ * producer-consumer buffers) must be submitted in a number
+ * <= pool size on an idle pool, so that all of them run
+ * at the same time.
+ */
+
+typedef struct pool_task{
+    void *(*routine)(void *);
+    void *arg;
+}pool_task;
+
+typedef struct thread_pool{
+    int             size;           //worker count
+    pthread_t       *tid;
+    pool_task       *queue;         //circular queue of submitted tasks
+    int             q_head;
+    int             q_count;
+    int             q_size;
+    int             pending;        //tasks queued or running
+    bool            exit;
+    pthread_mutex_t mux;
+    pthread_cond_t  work_cond;      //workers wait for tasks
+    pthread_cond_t  done_cond;      //pool_wait waits for pending == 0
+}thread_pool;
+
+thread_pool *pool_create(int size);
+
+void pool_destroy(thread_pool *pool);
+
+void pool_submit(thread_pool *pool, void *(*routine)(void *), void *arg);
+
+void pool_wait(thread_pool *pool);
+
+/**
+ * pool_parallel_for()
+ * -------------------
+ * runs body(arg, start, end) over [begin,end) split in
+ * chunks of `chunk` iterations, handed out dynamically
+ * to all the workers. Returns when the loop is completed
+ */
+void pool_parallel_for(thread_pool *pool, int begin, int end, int chunk, void (*body)(void *, int, int), void *arg);
+
+/**
+ * ### Spin Barrier
+ * ----------------
+ * Sense-reversing barrier built on atomics: threads spin
+ * for `spin` rounds on the global sense, then park on a
+ * condition variable (so oversubscribed runs don't burn
+ * the time slice of the last thread).
+ *
+ * barrier_enter() returns true in the last thread that
+ * arrives, BEFORE the others are released: that thread
+ * can run a serial section and then must call
+ * barrier_release(). The others return false once released.
+ * `local_sense` is private to each thread (init to 0).
+ */
+
+#ifndef BARRIER_SPIN
+#define BARRIER_SPIN 2000
+#endif
+
+#define CACHE_LINE 64
+
+typedef struct spin_barrier{
+    atomic_int      count;          //threads arrived
+    atomic_int      sense;          //flipped at each release
+    atomic_int      sleepers;       //threads parked on cond
+    int             size;
+    int             spin;
+    pthread_mutex_t mux;
+    pthread_cond_t  cond;
+}spin_barrier;
+
+void barrier_init(spin_barrier *b, int size, int spin);
+
+void barrier_destroy(spin_barrier *b);
+
+bool barrier_enter(spin_barrier *b, int *local_sense);
+
+void barrier_release(spin_barrier *b, int *local_sense);
+
+/**
+ * barrier_wait()
+ * --------------
+ * plain barrier (no serial section)
+ */
+void barrier_wait(spin_barrier *b, int *local_sense);
+
+#endif